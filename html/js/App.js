@@ -11,6 +11,11 @@
 
     updateInterval: 500,
     updatePollerId: null,
+    updateSeq: 0,
+    updateState: null,
+    subscriptions: {},
+    subscribeMsgid: 1,
+    subscribeRetryDelay: 10000,
     statsPollerId: null,
 
     username: null,
@@ -40,6 +45,14 @@
       if (msg.debug)
         YB.log(`[server] ${msg.debug}`);
 
+      //delta updates get merged into the full state first
+      if (msg.msg == "update")
+        msg = YB.App.mergeUpdate(msg);
+
+      //unchanged config, replay the one we already have
+      if (msg.msg == "config" && msg.not_modified)
+        msg = YB.App.config;
+
       if (msg.msg) {
         const callbacks = YB.App.messageCallbacks[msg.msg];
         if (!callbacks) {
@@ -249,7 +262,11 @@
       if (YB.App.role == "nobody")
         return;
 
-      YB.client.getConfig();
+      //only download the config again if it changed
+      if (YB.App.config.config_etag)
+        YB.client.send({ "cmd": "get_config", "if_none_match": YB.App.config.config_etag });
+      else
+        YB.client.getConfig();
 
       if (YB.App.role == "admin") {
         YB.client.getNetworkConfig();
@@ -392,7 +409,8 @@
 
     startStatsPoller: function () {
       if (!YB.App.statsPollerId) {
-        YB.App.statsPollerId = setInterval(YB.App.getStatsData, YB.App.updateInterval);
+        YB.App.subscribeTo("stats");
+        YB.App.statsPollerId = setInterval(() => YB.App.subscribeTo("stats"), YB.App.updateInterval);
       }
     },
 
@@ -400,19 +418,15 @@
       if (YB.App.statsPollerId) {
         clearInterval(YB.App.statsPollerId);
         YB.App.statsPollerId = 0;
-      }
-    },
-
-    getStatsData: function () {
-      if (YB.client.isOpen() && (YB.App.role == 'guest' || YB.App.role == 'admin')) {
-        YB.client.getStats();
+        YB.App.unsubscribeFrom("stats");
       }
     },
 
     startUpdatePoller: function () {
       if (!YB.App.updatePollerId) {
         // YB.log("starting updates");
-        YB.App.updatePollerId = setInterval(YB.App.getUpdateData, YB.App.updateInterval);
+        YB.App.subscribeTo("update");
+        YB.App.updatePollerId = setInterval(() => YB.App.subscribeTo("update"), YB.App.updateInterval);
       }
     },
 
@@ -421,12 +435,131 @@
         //YB.log("stopping updates");
         clearInterval(YB.App.updatePollerId);
         YB.App.updatePollerId = 0;
+        YB.App.unsubscribeFrom("update");
+      }
+    },
+
+    //the server pushes these to us, the pollers just make sure we're subscribed
+    //subscriptions die with the connection, so hello clears them
+    //if the server says no, we poll for it and ask again every so often
+    subscribeTo: function (topic) {
+      let sub = YB.App.subscriptions[topic];
+      if (sub && sub.state != "failed")
+        return;
+
+      if (sub) {
+        YB.App.pollTopic(topic);
+        if (Date.now() < sub.retryAt)
+          return;
+      }
+
+      if (YB.client.isOpen() && (YB.App.role == 'guest' || YB.App.role == 'admin')) {
+        let msgid = YB.App.subscribeMsgid++;
+        YB.App.subscriptions[topic] = { state: "pending", msgid: msgid };
+        YB.client.send({ cmd: "subscribe", topics: [topic], rate: YB.App.updateInterval, msgid: msgid }, false);
+      }
+    },
+
+    unsubscribeFrom: function (topic) {
+      let sub = YB.App.subscriptions[topic];
+      if (!sub)
+        return;
+
+      if (sub.state != "failed" && YB.client.isOpen())
+        YB.client.send({ cmd: "unsubscribe", topics: [topic] }, false);
+      delete YB.App.subscriptions[topic];
+    },
+
+    handleSubscribeMessage: function (msg) {
+      for (let topic of [].concat(msg.topics)) {
+        //ignore acks for topics we've dropped since
+        if (YB.App.subscriptions[topic])
+          YB.App.subscriptions[topic] = { state: "subscribed" };
+      }
+    },
+
+    //returns true if this error was the answer to one of our subscribes
+    handleSubscribeError: function (msg) {
+      if (msg.msgid === undefined)
+        return false;
+
+      for (let [topic, sub] of Object.entries(YB.App.subscriptions)) {
+        if (sub.state == "pending" && sub.msgid == msg.msgid) {
+          YB.log(`Unable to subscribe to ${topic}, polling instead: ${msg.message}`);
+          YB.App.subscriptions[topic] = { state: "failed", retryAt: Date.now() + YB.App.subscribeRetryDelay };
+          YB.App.pollTopic(topic);
+          return true;
+        }
+      }
+
+      return false;
+    },
+
+    pollTopic: function (topic) {
+      if (topic == "stats")
+        YB.App.getStatsData();
+      else
+        YB.App.getUpdateData();
+    },
+
+    getStatsData: function () {
+      if (YB.client.isOpen() && (YB.App.role == 'guest' || YB.App.role == 'admin')) {
+        YB.client.getStats();
       }
     },
 
     getUpdateData: function () {
       if (YB.client.isOpen() && (YB.App.role == 'guest' || YB.App.role == 'admin')) {
-        YB.client.getUpdate();
+        //only ask for what changed since the last update we got
+        YB.client.send({ cmd: "get_update", delta: true, seq: YB.App.updateSeq }, false);
+      }
+    },
+
+    mergeUpdate: function (msg) {
+      //fast updates are already partial, keep our state current and pass them on
+      if (msg.seq === undefined) {
+        if (YB.App.updateState) {
+          YB.App.mergeInto(YB.App.updateState, msg);
+          delete YB.App.updateState.fast;
+        }
+        return msg;
+      }
+
+      YB.App.updateSeq = msg.seq;
+
+      if (!msg.delta)
+        YB.App.updateState = msg;
+      else if (YB.App.updateState)
+        YB.App.mergeInto(YB.App.updateState, msg);
+      //a delta with nothing to apply it to, get a full one next time
+      else {
+        YB.App.updateSeq = 0;
+        return msg;
+      }
+
+      delete YB.App.updateState.delta;
+      return YB.App.updateState;
+    },
+
+    mergeInto: function (target, src) {
+      for (const key of Object.keys(src)) {
+        const value = src[key];
+        const existing = target[key];
+
+        //arrays of objects with ids (channels) are merged by id
+        if (Array.isArray(value) && Array.isArray(existing) && value.every(v => v && v.id !== undefined)) {
+          for (const item of value) {
+            const match = existing.find(e => e && e.id == item.id);
+            if (match)
+              YB.App.mergeInto(match, item);
+            else
+              existing.push(item);
+          }
+        }
+        else if (value && existing && typeof value === 'object' && typeof existing === 'object' && !Array.isArray(value) && !Array.isArray(existing))
+          YB.App.mergeInto(existing, value);
+        else
+          target[key] = value;
       }
     },
 
@@ -1067,12 +1200,21 @@
     },
 
     handleHelloMessage: function (msg) {
+      //new connection, start over with a full update
+      YB.App.updateSeq = 0;
+      YB.App.updateState = null;
+      YB.App.subscriptions = {};
+
       YB.App.role = msg.role;
       YB.App.defaultRole = msg.default_role;
 
       //custom board names.
       YB.App.updateBoardName(msg.name);
 
+      //brightness isn't part of config_etag, keep our cached config current
+      if (msg.brightness !== undefined && YB.App.config.config_etag)
+        YB.App.config.brightness = msg.brightness;
+
       //light/dark mode
       //let the mfd override with ?mode=night, etc.
       if (!YB.Util.getQueryVariable("mode")) {
@@ -1093,6 +1235,9 @@
     },
 
     handleStatusMessage: function (msg) {
+      if (msg.status == "error" && YB.App.handleSubscribeError(msg))
+        return;
+
       if (msg.status == "error")
         YB.App.showAlert(msg.message, "danger");
       else if (msg.status == "success")
@@ -1563,6 +1708,10 @@
     },
 
     handleSetBrightnessMessage: function (msg) {
+      //so a not_modified config replay doesn't bring back the old value
+      if (YB.App.config.config_etag)
+        YB.App.config.brightness = msg.brightness;
+
       //did we get brightness?
       if (msg.brightness && !YB.App.currentlyPickingBrightness)
         $('#brightnessSlider').val(Math.round(msg.brightness * 100));
@@ -1858,6 +2007,11 @@
   YB.App.onMessage("login", YB.App.handleLoginMessage);
   YB.App.onMessage("set_theme", YB.App.handleSetThemeMessage);
   YB.App.onMessage("set_brightness", YB.App.handleSetBrightnessMessage);
+  YB.App.onMessage("subscribe", YB.App.handleSubscribeMessage);
+  YB.App.onMessage("unsubscribe", function () { });
+  YB.App.onMessage("throttle", function (msg) {
+    YB.log(`Server is rate limiting us, retry in ${msg.retry_ms}ms`);
+  });
 
 
   //
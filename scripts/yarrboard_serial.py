@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+
+"""
+Reference host side for the framed Yarrboard serial API.
+
+Each frame on the wire is COBS encoded and ends with a 0x00:
+
+  cobs( [channel] [payload ...] [crc16 hi] [crc16 lo] ) 0x00
+
+channel 0 = JSON, 1 = MessagePack, 2 = log text (device to host only).
+The crc is CRC-16/CCITT-FALSE over the channel and payload.
+
+Turn it on in the firmware with yba.enable_serial_framing = true.
+
+Usage:
+  yarrboard_serial.py --port /dev/ttyUSB0 --baud 2000000 '{"cmd":"ping"}'
+  yarrboard_serial.py --port /dev/ttyACM0 --msgpack '{"cmd":"get_update"}'
+
+Needs pyserial, and msgpack for --msgpack.
+"""
+
+import argparse, json, sys, time
+
+CHANNEL_JSON = 0
+CHANNEL_MSGPACK = 1
+CHANNEL_LOG = 2
+
+def crc16(data, crc=0xFFFF):
+	for b in data:
+		crc ^= b << 8
+		for _ in range(8):
+			crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+			crc &= 0xFFFF
+	return crc
+
+def cobs_encode(data):
+	out = bytearray([0])
+	code_pos = 0
+	code = 1
+	for b in data:
+		if b != 0:
+			out.append(b)
+			code += 1
+		if b == 0 or code == 0xFF:
+			out[code_pos] = code
+			code_pos = len(out)
+			code = 1
+			out.append(0)
+	out[code_pos] = code
+	return bytes(out)
+
+def cobs_decode(data):
+	out = bytearray()
+	i = 0
+	while i < len(data):
+		code = data[i]
+		i += 1
+		if code == 0 or i + code - 1 > len(data):
+			raise ValueError("bad COBS data")
+		out += data[i:i + code - 1]
+		i += code - 1
+		if code != 0xFF and i < len(data):
+			out.append(0)
+	return bytes(out)
+
+def encode_frame(channel, payload):
+	raw = bytes([channel]) + payload
+	crc = crc16(raw)
+	return cobs_encode(raw + bytes([crc >> 8, crc & 0xFF])) + b"\x00"
+
+def decode_frame(frame):
+	"""frame without the trailing 0x00, returns (channel, payload) or raises ValueError"""
+	raw = cobs_decode(frame)
+	if len(raw) < 3:
+		raise ValueError("frame too short")
+	if crc16(raw[:-2]) != (raw[-2] << 8 | raw[-1]):
+		raise ValueError("bad crc")
+	return raw[0], raw[1:-2]
+
+class FrameDecoder:
+	"""feed() it bytes as they arrive, get back a list of (channel, payload)"""
+
+	def __init__(self):
+		self.buffer = bytearray()
+		self.bad_frames = 0
+
+	def feed(self, data):
+		frames = []
+		for b in data:
+			if b != 0:
+				self.buffer.append(b)
+				continue
+
+			# back to back delimiters are just padding
+			if self.buffer:
+				try:
+					frames.append(decode_frame(bytes(self.buffer)))
+				except ValueError:
+					self.bad_frames += 1
+				self.buffer.clear()
+		return frames
+
+if __name__ == '__main__':
+
+	parser = argparse.ArgumentParser(description="Talk to a Yarrboard over the framed serial API.")
+	parser.add_argument("--port", help="Serial port, eg. /dev/ttyUSB0", required=True)
+	parser.add_argument("--baud", help="Baud rate, ignored for USB CDC", type=int, default=115200)
+	parser.add_argument("--msgpack", help="Send the command as MessagePack", action="store_true")
+	parser.add_argument("--listen", help="Seconds to keep printing what comes back", type=float, default=2)
+	parser.add_argument("--no-log", help="Hide the log channel", action="store_true")
+	parser.add_argument("command", nargs="*", help="JSON commands to send")
+
+	args = parser.parse_args()
+
+	import serial
+	if args.msgpack:
+		import msgpack
+
+	port = serial.Serial(args.port, args.baud, timeout=0.05)
+
+	# a lone delimiter flushes any junk sitting in the device's receive buffer
+	port.write(b"\x00")
+
+	for command in args.command:
+		message = json.loads(command)
+		if args.msgpack:
+			port.write(encode_frame(CHANNEL_MSGPACK, msgpack.packb(message)))
+		else:
+			port.write(encode_frame(CHANNEL_JSON, json.dumps(message, separators=(",", ":")).encode()))
+
+	decoder = FrameDecoder()
+	end = time.time() + args.listen
+	while time.time() < end:
+		for channel, payload in decoder.feed(port.read(4096)):
+			if channel == CHANNEL_JSON:
+				print(payload.decode(errors="replace"))
+			elif channel == CHANNEL_MSGPACK:
+				print(json.dumps(msgpack.unpackb(payload) if args.msgpack else payload.hex()))
+			elif channel == CHANNEL_LOG and not args.no_log:
+				print("[log] " + payload.decode(errors="replace"), file=sys.stderr)
+
+	if decoder.bad_frames:
+		print(f"{decoder.bad_frames} bad frames", file=sys.stderr)
@@ -0,0 +1,55 @@
+/*
+ * Yarrboard Framework
+ *
+ * Copyright (c) 2025 Zach Hoeken <hoeken@gmail.com>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include "ChunkedPrint.h"
+#include <algorithm>
+#include <cstring>
+
+size_t ChunkedPrint::write(const uint8_t* data, size_t len)
+{
+  if (_failed)
+    return 0;
+
+  size_t written = 0;
+  while (written < len) {
+    // more is coming, so the full buffer can go out as a middle chunk
+    if (_len == _size) {
+      if (!_sink(_buffer, _len, false)) {
+        _failed = true;
+        return written;
+      }
+      _len = 0;
+    }
+
+    size_t n = std::min(len - written, _size - _len);
+    memcpy(_buffer + _len, data + written, n);
+    _len += n;
+    written += n;
+  }
+
+  _total += written;
+  return written;
+}
+
+bool ChunkedPrint::finish()
+{
+  if (_failed)
+    return false;
+
+  if (_total == 0)
+    return true;
+
+  _failed = !_sink(_buffer, _len, true);
+  _len = 0;
+
+  return !_failed;
+}
@@ -0,0 +1,62 @@
+/*
+ * Yarrboard Framework
+ *
+ * Copyright (c) 2025 Zach Hoeken <hoeken@gmail.com>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#ifndef YARR_CHUNKED_PRINT_H
+#define YARR_CHUNKED_PRINT_H
+
+#include "YarrboardHAL.h"
+#include <functional>
+
+/**
+ * ChunkedPrint
+ *
+ * A Print that collects output in a small fixed buffer and hands it to a sink
+ * one chunk at a time, so a big message can be serialized straight onto the
+ * wire without measuring it first or holding all of it in memory:
+ *
+ *   ChunkedPrint out(buf, sizeof(buf), [&](const uint8_t* data, size_t len, bool final) {
+ *     return sendSomewhere(data, len, final) == ESP_OK;
+ *   });
+ *   serializeJson(doc, out);
+ *   out.finish();
+ *
+ * A full buffer is only sent once more data shows up, so the sink always
+ * knows which chunk is the last one and it is never empty (unless nothing
+ * was written at all).  Once the sink returns false everything else is
+ * thrown away and finish() returns false.
+ */
+class ChunkedPrint : public Print
+{
+  public:
+    typedef std::function<bool(const uint8_t* data, size_t len, bool final)> ChunkSink;
+
+    ChunkedPrint(uint8_t* buffer, size_t size, ChunkSink sink) : _buffer(buffer), _size(size), _sink(sink) {}
+
+    size_t write(uint8_t b) override { return write(&b, 1); }
+    size_t write(const uint8_t* data, size_t len) override;
+
+    // send whatever is left as the final chunk
+    bool finish();
+
+    size_t total() const { return _total; }
+    bool failed() const { return _failed; }
+
+  private:
+    uint8_t* _buffer;
+    size_t _size;
+    size_t _len = 0;
+    size_t _total = 0;
+    bool _failed = false;
+    ChunkSink _sink;
+};
+
+#endif /* !YARR_CHUNKED_PRINT_H */
@@ -22,6 +22,9 @@ ConfigManager::ConfigManager(YarrboardApp& app) : BaseController(app, "config"),
 
 bool ConfigManager::setup()
 {
+  // a new boot id means clients can't match an etag from before a reboot or reflash
+  _bootId = esp_random();
+
   // setup some defaults
   strlcpy(board_name, _app.board_name, sizeof(board_name));
   strlcpy(local_hostname, _app.default_hostname, sizeof(local_hostname));
@@ -71,8 +74,23 @@ bool ConfigManager::setup()
   return true;
 }
 
+void ConfigManager::markChanged()
+{
+  _generation++;
+  _app.protocol.invalidateCache();
+}
+
+const char* ConfigManager::getETag(char* buf, size_t len) const
+{
+  snprintf(buf, len, "%08lx-%lu", (unsigned long)_bootId, (unsigned long)_generation);
+  return buf;
+}
+
 bool ConfigManager::saveConfig(char* error, size_t len)
 {
+  // whatever changed, the cached get_config etc are stale now
+  markChanged();
+
   // our doc to store.
   JsonDocument config;
 
@@ -177,14 +195,14 @@ void ConfigManager::generateBoardConfig(JsonVariant output)
 
   // hook for our hardware capabilities
   JsonObject capabilities = output["capabilities"].to<JsonObject>();
-  for (const auto& entry : _app.getControllers()) {
-    entry.controller->generateCapabilitiesHook(capabilities);
-  }
+  _app.forEachHook(YB_HOOK_CAPABILITIES, [&](BaseController* controller) {
+    controller->generateCapabilitiesHook(capabilities);
+  });
 
   // hook for each controller
-  for (const auto& entry : _app.getControllers()) {
-    entry.controller->generateConfigHook(output);
-  }
+  _app.forEachHook(YB_HOOK_CONFIG, [&](BaseController* controller) {
+    controller->generateConfigHook(output);
+  });
 }
 
 void ConfigManager::generateAppConfig(JsonVariant output)
@@ -426,9 +444,9 @@ bool ConfigManager::loadBoardConfigFromJSON(JsonVariant config, char* error, siz
   const char* v = config["name"] | _app.board_name;
   strlcpy(board_name, v, sizeof(board_name));
 
-  for (const auto& entry : _app.getControllers()) {
-    entry.controller->loadConfigHook(config, error, len);
-  }
+  _app.forEachHook(YB_HOOK_LOAD_CONFIG, [&](BaseController* controller) {
+    controller->loadConfigHook(config, error, len);
+  });
 
   return result;
 }
\ No newline at end of file
@@ -72,6 +72,12 @@ class ConfigManager : public BaseController
 
     // Core Config Logic
     bool saveConfig(char* error, size_t len);
+
+    // Config ETag: "<boot id>-<generation>", bumped whenever the config changes
+    static constexpr size_t ETAG_LENGTH = 24;
+    void markChanged();
+    uint32_t getGeneration() const { return _generation; }
+    const char* getETag(char* buf, size_t len) const;
     bool loadConfigFromFile(const char* file, char* error, size_t len);
 
     // JSON Loading
@@ -88,6 +94,9 @@ class ConfigManager : public BaseController
 
   private:
     YarrboardApp& _app;
+
+    uint32_t _bootId = 0;
+    uint32_t _generation = 1;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,90 @@
+/*
+ * Yarrboard Framework
+ *
+ * Copyright (c) 2025 Zach Hoeken <hoeken@gmail.com>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include "ControllerScheduler.h"
+
+bool ControllerScheduler::add(BaseController* controller, uint8_t order, const ControllerSchedule& schedule)
+{
+  if (!controller)
+    return false;
+
+  if (schedule.wake_on_event && _wakeable.full())
+    return false;
+
+  controller->getTiming().budget_us = schedule.budget_us;
+  controller->getTiming().deferrable = schedule.deferrable;
+
+  // classic behavior: run on every pass, sorted by order
+  if (schedule.period_ms == 0) {
+    if (_everyPass.full())
+      return false;
+
+    size_t i = 0;
+    while (i < _everyPassOrder.size() && _everyPassOrder[i] <= order)
+      i++;
+
+    _everyPass.insert(_everyPass.begin() + i, controller);
+    _everyPassOrder.insert(_everyPassOrder.begin() + i, order);
+  }
+  // event only controllers never go into the deadline heap
+  else if (schedule.period_ms != ControllerSchedule::EVENT_ONLY) {
+    if (_heap.full())
+      return false;
+
+    // first run is one period after registration
+    _heap.push_back({controller, (uint32_t)(yb_millis() + schedule.period_ms), schedule.period_ms, schedule.priority});
+    std::push_heap(_heap.begin(), _heap.end(), later);
+  }
+
+  if (schedule.wake_on_event)
+    _wakeable.push_back(controller);
+
+  return true;
+}
+
+void ControllerScheduler::remove(BaseController* controller)
+{
+  for (size_t i = 0; i < _everyPass.size(); i++) {
+    if (_everyPass[i] == controller) {
+      _everyPass.erase(_everyPass.begin() + i);
+      _everyPassOrder.erase(_everyPassOrder.begin() + i);
+      break;
+    }
+  }
+
+  for (auto it = _wakeable.begin(); it != _wakeable.end(); ++it) {
+    if (*it == controller) {
+      _wakeable.erase(it);
+      break;
+    }
+  }
+
+  for (auto it = _heap.begin(); it != _heap.end(); ++it) {
+    if (it->controller == controller) {
+      _heap.erase(it);
+      std::make_heap(_heap.begin(), _heap.end(), later);
+      break;
+    }
+  }
+}
+
+uint32_t ControllerScheduler::msUntilNextDeadline(uint32_t now) const
+{
+  if (_heap.empty())
+    return ControllerSchedule::EVENT_ONLY;
+
+  uint32_t due = _heap.front().due_ms;
+  if (isDue(due, now))
+    return 0;
+
+  return due - now;
+}
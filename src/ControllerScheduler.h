@@ -0,0 +1,169 @@
+/*
+ * Yarrboard Framework
+ *
+ * Copyright (c) 2025 Zach Hoeken <hoeken@gmail.com>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#ifndef YARR_CONTROLLER_SCHEDULER_H
+#define YARR_CONTROLLER_SCHEDULER_H
+
+#include "YarrboardConfig.h"
+#include "YarrboardHAL.h"
+#include "controllers/BaseController.h"
+#include <algorithm>
+#include <etl/vector.h>
+
+/**
+ * How often the app should call a controller's loop().
+ *
+ * The defaults keep the classic behavior of running the controller on every
+ * pass of YarrboardApp::loop().
+ */
+struct ControllerSchedule {
+    // period_ms value for controllers that only run when signal()'d
+    static constexpr uint32_t EVENT_ONLY = UINT32_MAX;
+
+    uint32_t period_ms = 0;     // 0 = every pass, otherwise minimum ms between runs
+    uint8_t priority = 0;       // higher runs first when deadlines tie
+    bool wake_on_event = false; // controller->signal() runs it on the next pass
+    uint8_t group = 0;          // task group from YarrboardApp::addTaskGroup(), 0 = Arduino loop()
+    uint32_t budget_us = 0;     // expected worst case for one loop(), 0 = no budget
+    bool deferrable = false;    // skip to a later pass if the frame is already over budget
+
+    ControllerSchedule() {}
+    ControllerSchedule(uint32_t period, uint8_t prio = 0, bool wake = false, uint8_t grp = 0) : period_ms(period), priority(prio), wake_on_event(wake), group(grp) {}
+};
+
+/**
+ * ControllerScheduler
+ *
+ * Decides which controllers are due on each pass of the main loop:
+ * - Every-pass controllers run in registration order, like before.
+ * - Periodic controllers sit in a min-heap keyed on their next deadline,
+ *   so a pass only touches the ones that are actually due.
+ * - Wake-on-event controllers additionally run on the pass after signal().
+ *
+ * Deadlines use millis() with wraparound-safe signed comparisons.
+ *
+ * Every run is timed with micros() into the controller's ControllerTiming.
+ * Once a pass has used up its frame budget, deferrable controllers are
+ * skipped until a later pass (at most YB_MAX_DEFERRALS in a row).
+ */
+class ControllerScheduler
+{
+  public:
+    bool add(BaseController* controller, uint8_t order, const ControllerSchedule& schedule);
+    void remove(BaseController* controller);
+
+    // Run everything that is due at `now`.  `dispatch` is called with each
+    // controller that should run, and is responsible for calling loop().
+    // frame_budget_us = 0 disables deferral.
+    template <typename Dispatch>
+    void run(uint32_t now, uint32_t frame_budget_us, Dispatch&& dispatch)
+    {
+      uint32_t frameStart = yb_micros();
+      bool overBudget = false;
+
+      auto runOne = [&](BaseController* c) {
+        uint32_t start = yb_micros();
+        dispatch(c);
+        uint32_t end = yb_micros();
+        record(c->getTiming(), end - start);
+
+        if (frame_budget_us && end - frameStart > frame_budget_us)
+          overBudget = true;
+      };
+
+      for (BaseController* c : _everyPass) {
+        if (!shouldDefer(c->getTiming(), overBudget))
+          runOne(c);
+      }
+
+      // deferred signals stay set for the next pass
+      for (BaseController* c : _wakeable) {
+        if (c->isSignalled() && !shouldDefer(c->getTiming(), overBudget)) {
+          c->takeSignal();
+          runOne(c);
+        }
+      }
+
+      while (!_heap.empty() && isDue(_heap.front().due_ms, now)) {
+        std::pop_heap(_heap.begin(), _heap.end(), later);
+        Task& t = _heap.back();
+
+        if (shouldDefer(t.controller->getTiming(), overBudget)) {
+          // try again next millisecond
+          t.due_ms = now + 1;
+        } else {
+          runOne(t.controller);
+
+          // no catch-up bursts if we fell behind, just run again one period from now
+          t.due_ms += t.period_ms;
+          if (isDue(t.due_ms, now))
+            t.due_ms = now + t.period_ms;
+        }
+
+        std::push_heap(_heap.begin(), _heap.end(), later);
+      }
+    }
+
+    // Milliseconds until the next periodic controller is due (0 = due now).
+    // Returns EVENT_ONLY when nothing periodic is scheduled.
+    uint32_t msUntilNextDeadline(uint32_t now) const;
+
+    size_t everyPassCount() const { return _everyPass.size(); }
+    size_t scheduledCount() const { return _heap.size(); }
+
+  private:
+    struct Task {
+        BaseController* controller;
+        uint32_t due_ms;
+        uint32_t period_ms;
+        uint8_t priority;
+    };
+
+    etl::vector<BaseController*, YB_MAX_CONTROLLERS> _everyPass;
+    etl::vector<uint8_t, YB_MAX_CONTROLLERS> _everyPassOrder;
+    etl::vector<BaseController*, YB_MAX_CONTROLLERS> _wakeable;
+    etl::vector<Task, YB_MAX_CONTROLLERS> _heap;
+
+    static bool isDue(uint32_t due_ms, uint32_t now) { return (int32_t)(now - due_ms) >= 0; }
+
+    static void record(ControllerTiming& timing, uint32_t elapsed_us)
+    {
+      timing.last_us = elapsed_us;
+      if (elapsed_us > timing.worst_us)
+        timing.worst_us = elapsed_us;
+      if (timing.budget_us && elapsed_us > timing.budget_us)
+        timing.overruns++;
+    }
+
+    static bool shouldDefer(ControllerTiming& timing, bool overBudget)
+    {
+      if (!overBudget || !timing.deferrable || timing.deferStreak >= YB_MAX_DEFERRALS) {
+        timing.deferStreak = 0;
+        return false;
+      }
+
+      timing.deferStreak++;
+      timing.deferred++;
+      return true;
+    }
+
+    // heap ordering: true if a should run after b
+    static bool later(const Task& a, const Task& b)
+    {
+      int32_t delta = (int32_t)(a.due_ms - b.due_ms);
+      if (delta != 0)
+        return delta > 0;
+      return a.priority < b.priority;
+    }
+};
+
+#endif /* !YARR_CONTROLLER_SCHEDULER_H */
@@ -0,0 +1,100 @@
+/*
+ * Yarrboard Framework
+ *
+ * Copyright (c) 2025 Zach Hoeken <hoeken@gmail.com>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include "FrameCodec.h"
+
+size_t FrameCodec::encode(uint8_t* buf, size_t size, size_t pos, uint8_t channel, const uint8_t* data, size_t len)
+{
+  size_t written = 0;
+
+  auto put = [&](uint8_t b) {
+    buf[pos] = b;
+    pos = (pos + 1) % size;
+    written++;
+  };
+
+  // COBS: each code byte says how far it is to the next zero
+  size_t codePos = pos;
+  uint8_t code = 1;
+  put(0);
+
+  auto add = [&](uint8_t b) {
+    if (b != 0) {
+      put(b);
+      code++;
+    }
+
+    if (b == 0 || code == 0xFF) {
+      buf[codePos] = code;
+      codePos = pos;
+      code = 1;
+      put(0);
+    }
+  };
+
+  uint16_t crc = crc16(0xFFFF, &channel, 1);
+  crc = crc16(crc, data, len);
+
+  add(channel);
+  for (size_t i = 0; i < len; i++)
+    add(data[i]);
+  add(crc >> 8);
+  add(crc & 0xFF);
+
+  buf[codePos] = code;
+  put(0);
+
+  return written;
+}
+
+bool FrameCodec::decode(uint8_t* buf, size_t frameLen, uint8_t& channel, size_t& len)
+{
+  // undo the COBS encoding in place, the output is always shorter
+  size_t in = 0;
+  size_t out = 0;
+  while (in < frameLen) {
+    uint8_t code = buf[in++];
+    if (code == 0 || in + code - 1 > frameLen)
+      return false;
+
+    for (uint8_t i = 1; i < code; i++)
+      buf[out++] = buf[in++];
+
+    if (code != 0xFF && in < frameLen)
+      buf[out++] = 0;
+  }
+
+  // channel + crc at the very least
+  if (out < 3)
+    return false;
+
+  uint16_t crc = (buf[out - 2] << 8) | buf[out - 1];
+  if (crc16(0xFFFF, buf, out - 2) != crc)
+    return false;
+
+  channel = buf[0];
+  len = out - 3;
+  buf[1 + len] = '\0';
+  return true;
+}
+
+uint16_t FrameCodec::crc16(uint16_t crc, const uint8_t* data, size_t len)
+{
+  // CRC-16/CCITT-FALSE, poly 0x1021
+  for (size_t i = 0; i < len; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (uint8_t bit = 0; bit < 8; bit++)
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+
+  return crc;
+}
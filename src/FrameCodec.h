@@ -0,0 +1,47 @@
+/*
+ * Yarrboard Framework
+ *
+ * Copyright (c) 2025 Zach Hoeken <hoeken@gmail.com>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#ifndef YARR_FRAME_CODEC_H
+#define YARR_FRAME_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * FrameCodec
+ *
+ * The framed serial wire format: [channel][payload][crc16], COBS encoded and
+ * terminated by a 0x00.  The crc is CRC-16/CCITT-FALSE over channel and
+ * payload, big endian.  scripts/yarrboard_serial.py is the host side.
+ *
+ * No hardware in here, so it builds natively for the tests.
+ */
+class FrameCodec
+{
+  public:
+    // worst case size on the wire for a payload of len bytes, terminator included
+    static constexpr size_t maxEncodedSize(size_t len) { return (len + 3) + (len + 3) / 254 + 2; }
+
+    // Encode a frame into buf starting at pos, wrapping around at size so it
+    // can go straight into a ring buffer.  Returns the number of bytes written,
+    // the caller makes sure there is room for maxEncodedSize(len).
+    static size_t encode(uint8_t* buf, size_t size, size_t pos, uint8_t channel, const uint8_t* data, size_t len);
+
+    // Decode a frame (without its 0x00 terminator) in place.  On success the
+    // payload starts at buf + 1, is len bytes long and is followed by a null.
+    // False if the COBS or the crc is bad.
+    static bool decode(uint8_t* buf, size_t frameLen, uint8_t& channel, size_t& len);
+
+    static uint16_t crc16(uint16_t crc, const uint8_t* data, size_t len);
+};
+
+#endif /* !YARR_FRAME_CODEC_H */
@@ -12,88 +12,148 @@
 
 // IntervalTimer.h
 #pragma once
-#include "YarrboardDebug.h"
-#include <Arduino.h>
+#include "YarrboardConfig.h"
+#include "YarrboardHAL.h"
 #include <cstring>
+#include <etl/vector.h>
 #include <stdint.h>
-#include <vector>
 
 /**
  * IntervalTimer
- * * A lightweight profiling tool for Arduino to measure and average execution time of
+ * * A lightweight profiling tool for Arduino to measure execution time of
  * code blocks using microsecond precision.
  * * Usage:
  * - Initialize with a Print object (e.g., IntervalTimer timer(Serial) or timer(YBP)).
  * - Call start() once to set the baseline timestamp.
  * - Call time("label") at the end of a code block to record micros since the last mark.
- * - Call print() to output a summary table of averages to the configured Print device.
+ * - Or, in hot paths, YB_PROBE(timer, "label"): the label is interned to an index the first
+ * time through, so each call after that is an array increment instead of a strcmp scan.
+ * - Call print() to output a summary table to the configured Print device.
  * - Call getEntries() to retrieve raw data for custom processing or JSON serialization.
  *
  * Technical Notes:
  * - Rollover-Safe: Uses uint32_t subtraction with micros() to handle hardware timer wrap-around.
- * - Memory: Stores results in a std::vector. Labels should be stable C-strings (string literals)
- * to avoid memory corruption or excessive string comparison.
+ * - Memory: Entries live in a fixed-capacity etl::vector (YB_INTERVAL_TIMER_MAX_LABELS), so
+ * time() never allocates.  Labels past the capacity are ignored.  Labels should be stable
+ * C-strings (string literals).
+ * - Percentiles: each label keeps a log2 histogram (bucket b holds [2^(b-1), 2^b) us) along
+ * with min/max, so p50/p90/p99 are approximate but cheap.
+ * - Build with -D YB_DISABLE_PROBES to compile every YB_PROBE out.
  * - Flexibility: Output can be redirected to any Arduino 'Print' child class (Serial, File, LCD).
  */
 class IntervalTimer
 {
   public:
+    static constexpr size_t BUCKETS = YB_INTERVAL_TIMER_BUCKETS;
+
     struct Entry {
         const char* label; // expected to be a stable C-string (e.g., literal)
         uint64_t total_us; // sum of intervals in microseconds
         uint32_t count;    // number of intervals recorded
+        uint32_t min_us;
+        uint32_t max_us;
+        uint32_t buckets[BUCKETS];
+
+        uint32_t average() const { return count ? static_cast<uint32_t>(total_us / count) : 0; }
+
+        // Approximate percentile (0-100) from the histogram, clamped to min/max.
+        uint32_t percentile(uint8_t pct) const
+        {
+          if (!count)
+            return 0;
+
+          uint32_t target = ((uint64_t)count * pct + 99) / 100;
+          if (!target)
+            target = 1;
+
+          uint32_t seen = 0;
+          for (size_t b = 0; b < BUCKETS; b++) {
+            seen += buckets[b];
+            if (seen >= target) {
+              // middle of the bucket's range
+              uint32_t lo = b ? (1UL << (b - 1)) : 0;
+              uint32_t hi = (1UL << b);
+              uint32_t v = lo + (hi - lo) / 2;
+              return v < min_us ? min_us : (v > max_us ? max_us : v);
+            }
+          }
+
+          return max_us;
+        }
     };
 
-    // Constructor now accepts a Print object, defaulting to Serial
-    IntervalTimer(Print& printer = Serial) : _printer(&printer), _last_us(0) {}
+    // Constructor now accepts a Print object, defaulting to Serial (stdout on native)
+    IntervalTimer(Print& printer = yb_default_print()) : _printer(&printer), _last_us(0) {}
 
     // Allow changing the printer at runtime if needed
     void setPrinter(Print& printer) { _printer = &printer; }
 
     // Mark the starting point for the next interval.
-    void start() { _last_us = micros(); }
+    void start() { _last_us = yb_micros(); }
 
     // Record elapsed time since the most recent start()/time() and attribute it to `label`.
     void time(const char* label)
     {
-      const uint32_t now = micros();
+      const uint32_t now = yb_micros();
       const uint32_t delta = now - _last_us; // rollover-safe with unsigned math
       _last_us = now;
 
-      Entry& e = findOrCreate(label);
-      e.total_us += static_cast<uint64_t>(delta);
-      e.count += 1;
+      Entry* e = findOrCreate(label);
+      if (e)
+        record(*e, delta);
+    }
+
+    // Same as above, with an id from intern().  Negative ids are ignored.
+    void time(int16_t id)
+    {
+      const uint32_t now = yb_micros();
+      const uint32_t delta = now - _last_us;
+      _last_us = now;
+
+      if (id >= 0 && (size_t)id < _entries.size())
+        record(_entries[id], delta);
+    }
+
+    // Look up (or add) a label once and get a stable id for time(id).
+    // Returns -1 if we're out of labels.
+    int16_t intern(const char* label)
+    {
+      Entry* e = findOrCreate(label);
+      return e ? (int16_t)(e - _entries.data()) : -1;
     }
 
     // Clear all recorded stats and reset the last timestamp.
+    // Labels are kept so interned ids stay valid.
     void reset()
     {
-      _entries.clear();
-      _last_us = micros();
+      for (auto& e : _entries)
+        clear(e);
+      _last_us = yb_micros();
     }
 
-    const std::vector<Entry>& getEntries() const
+    const etl::vector<Entry, YB_INTERVAL_TIMER_MAX_LABELS>& getEntries() const
     {
       return _entries;
     }
 
-    // Print averages for each label.
+    // Print averages and tails for each label.
     void print(uint32_t interval_ms = 0)
     {
       if (_entries.empty())
         return;
 
       unsigned long total_us = 0;
-      _printer->println(F("=== IntervalTimer averages (us) ==="));
+      _printer->println("=== IntervalTimer (us) ===");
       for (const auto& e : _entries) {
         if (e.count == 0)
           continue;
-        const uint32_t avg_us = static_cast<uint32_t>(e.total_us / e.count);
+        const uint32_t avg_us = e.average();
         total_us += avg_us;
-        // Keep it simple: label, average in microseconds, and sample count.
-        _printer->printf("%s: avg=%lu us  (n=%lu)\n",
+        _printer->printf("%s: avg=%lu p99=%lu max=%lu us  (n=%lu)\n",
           e.label ? e.label : "(null)",
           static_cast<unsigned long>(avg_us),
+          static_cast<unsigned long>(e.percentile(99)),
+          static_cast<unsigned long>(e.max_us),
           static_cast<unsigned long>(e.count));
       }
       _printer->printf("Total: avg=%lu us\n",
@@ -102,17 +162,62 @@ class IntervalTimer
 
   private:
     Print* _printer; // Pointer to the output stream
-    std::vector<Entry> _entries;
+    etl::vector<Entry, YB_INTERVAL_TIMER_MAX_LABELS> _entries;
     uint32_t _last_us; // last timestamp from start()/time(), in micros()
 
-    Entry& findOrCreate(const char* label)
+    static size_t bucketFor(uint32_t us)
+    {
+      size_t b = us ? 32 - __builtin_clz(us) : 0;
+      return b < BUCKETS ? b : BUCKETS - 1;
+    }
+
+    static void record(Entry& e, uint32_t delta)
+    {
+      e.total_us += static_cast<uint64_t>(delta);
+      e.count += 1;
+      if (delta < e.min_us)
+        e.min_us = delta;
+      if (delta > e.max_us)
+        e.max_us = delta;
+      e.buckets[bucketFor(delta)]++;
+    }
+
+    static void clear(Entry& e)
+    {
+      const char* label = e.label;
+      memset(&e, 0, sizeof(e));
+      e.label = label;
+      e.min_us = UINT32_MAX;
+    }
+
+    Entry* findOrCreate(const char* label)
     {
       for (auto& e : _entries) {
         if ((e.label == label) || (e.label && label && std::strcmp(e.label, label) == 0)) {
-          return e;
+          return &e;
         }
       }
-      _entries.push_back({label, 0ULL, 0U});
-      return _entries.back();
+
+      if (_entries.full())
+        return nullptr;
+
+      _entries.push_back(Entry());
+      Entry& e = _entries.back();
+      e.label = label;
+      clear(e);
+      return &e;
     }
 };
+
+#ifdef YB_DISABLE_PROBES
+  #define YB_PROBE(timer, label) \
+    do {                         \
+    } while (0)
+#else
+  // one id per call site, so use a single timer at each site
+  #define YB_PROBE(timer, label)                                  \
+    do {                                                          \
+      static const int16_t _yb_probe_id = (timer).intern(label); \
+      (timer).time(_yb_probe_id);                                 \
+    } while (0)
+#endif
\ No newline at end of file
@@ -0,0 +1,157 @@
+/*
+ * Yarrboard Framework
+ *
+ * Copyright (c) 2025 Zach Hoeken <hoeken@gmail.com>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include "JsonPool.h"
+
+JsonPool jsonPool;
+
+// block size and how many of each, times YB_JSON_POOL_SCALE.  ArduinoJson
+// grows documents in ~1 KB chunks, strings and small buffers are the rest.
+static const struct {
+    uint16_t block;
+    uint16_t count;
+} slabSpecs[] = {
+  {32, 64},
+  {64, 32},
+  {128, 16},
+  {256, 8},
+  {512, 8},
+  {1024, 12},
+  {2048, 4},
+  {4096, 2},
+};
+
+bool JsonPool::begin()
+{
+  static_assert(sizeof(slabSpecs) / sizeof(slabSpecs[0]) == SLAB_COUNT, "slabSpecs doesn't match SLAB_COUNT");
+
+  if (_base != nullptr || YB_JSON_POOL_SCALE == 0)
+    return true;
+
+  size_t total = 0;
+  for (auto& spec : slabSpecs)
+    total += spec.block * spec.count * YB_JSON_POOL_SCALE;
+
+  uint8_t* base = (uint8_t*)malloc(total);
+  if (base == nullptr)
+    return false;
+
+  // carve it up and thread each slab's free list
+  uint8_t* p = base;
+  for (size_t i = 0; i < SLAB_COUNT; i++) {
+    Slab& slab = _slabs[i];
+    slab.block = slabSpecs[i].block;
+    slab.count = slabSpecs[i].count * YB_JSON_POOL_SCALE;
+    slab.start = p;
+    slab.free = nullptr;
+
+    for (size_t j = slab.count; j > 0; j--) {
+      void* block = p + (j - 1) * slab.block;
+      *(void**)block = slab.free;
+      slab.free = block;
+    }
+
+    p += slab.block * slab.count;
+  }
+
+  portENTER_CRITICAL(&_lock);
+  _base = base;
+  _size = total;
+  portEXIT_CRITICAL(&_lock);
+
+  return true;
+}
+
+void* JsonPool::allocate(size_t size)
+{
+  portENTER_CRITICAL(&_lock);
+
+  // smallest block that fits, or the next size up if those are all taken
+  for (Slab& slab : _slabs) {
+    if (slab.block < size || slab.free == nullptr)
+      continue;
+
+    void* block = slab.free;
+    slab.free = *(void**)block;
+
+    hits++;
+    _used += slab.block;
+    if (_used > _peak)
+      _peak = _used;
+
+    portEXIT_CRITICAL(&_lock);
+    return block;
+  }
+
+  misses++;
+  portEXIT_CRITICAL(&_lock);
+
+  return malloc(size);
+}
+
+void JsonPool::deallocate(void* ptr)
+{
+  portENTER_CRITICAL(&_lock);
+
+  Slab* slab = owner(ptr);
+  if (slab != nullptr) {
+    *(void**)ptr = slab->free;
+    slab->free = ptr;
+    _used -= slab->block;
+  }
+
+  portEXIT_CRITICAL(&_lock);
+
+  if (slab == nullptr)
+    free(ptr);
+}
+
+void* JsonPool::reallocate(void* ptr, size_t new_size)
+{
+  if (ptr == nullptr)
+    return allocate(new_size);
+
+  portENTER_CRITICAL(&_lock);
+  Slab* slab = owner(ptr);
+  if (slab == nullptr)
+    misses++;
+  portEXIT_CRITICAL(&_lock);
+
+  if (slab == nullptr)
+    return realloc(ptr, new_size);
+
+  // shrinking, or still fits in the block it has
+  if (new_size <= slab->block)
+    return ptr;
+
+  void* bigger = allocate(new_size);
+  if (bigger == nullptr)
+    return nullptr;
+
+  memcpy(bigger, ptr, slab->block);
+  deallocate(ptr);
+
+  return bigger;
+}
+
+JsonPool::Slab* JsonPool::owner(void* ptr)
+{
+  uint8_t* p = (uint8_t*)ptr;
+  if (p < _base || p >= _base + _size)
+    return nullptr;
+
+  for (Slab& slab : _slabs)
+    if (p < slab.start + slab.block * slab.count)
+      return &slab;
+
+  return nullptr;
+}
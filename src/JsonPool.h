@@ -0,0 +1,79 @@
+/*
+ * Yarrboard Framework
+ *
+ * Copyright (c) 2025 Zach Hoeken <hoeken@gmail.com>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#ifndef YARR_JSON_POOL_H
+#define YARR_JSON_POOL_H
+
+#include "YarrboardConfig.h"
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+/**
+ * JsonPool
+ *
+ * Fixed size block allocator for the short lived stuff every message makes:
+ * JsonDocuments and the buffers they get serialized into.  One region is
+ * carved up at boot into slabs of 32 byte to 4 KB blocks, so messages reuse
+ * the same memory over and over instead of slowly fragmenting the heap.
+ *
+ *   JsonDocument doc(&jsonPool);
+ *   char* buf = (char*)jsonPool.allocate(size);
+ *   ...
+ *   jsonPool.deallocate(buf);
+ *
+ * Requests that are too big, or whose slab is empty, go to the regular heap
+ * and count as a miss.  deallocate() can tell the two apart, so callers don't
+ * need to care.  Long lived documents (caches etc) should stay on the heap.
+ *
+ * Safe to use from any task.
+ */
+class JsonPool : public ArduinoJson::Allocator
+{
+  public:
+    uint32_t hits = 0;
+    uint32_t misses = 0;
+
+    bool begin();
+
+    void* allocate(size_t size) override;
+    void deallocate(void* ptr) override;
+    void* reallocate(void* ptr, size_t new_size) override;
+
+    // bytes of pool blocks handed out now, at most, and in total
+    size_t used() const { return _used; }
+    size_t peak() const { return _peak; }
+    size_t capacity() const { return _size; }
+
+  private:
+    struct Slab {
+        size_t block;
+        size_t count;
+        uint8_t* start;
+        void* free; // linked through the first word of each free block
+    };
+
+    static constexpr size_t SLAB_COUNT = 8;
+    Slab _slabs[SLAB_COUNT] = {};
+
+    uint8_t* _base = nullptr;
+    size_t _size = 0;
+    size_t _used = 0;
+    size_t _peak = 0;
+
+    portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+
+    Slab* owner(void* ptr);
+};
+
+extern JsonPool jsonPool;
+
+#endif /* !YARR_JSON_POOL_H */
@@ -0,0 +1,105 @@
+/*
+ * Yarrboard Framework
+ *
+ * Copyright (c) 2025 Zach Hoeken <hoeken@gmail.com>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include "ResponseCache.h"
+
+bool ResponseCache::begin()
+{
+  _mutex = xSemaphoreCreateMutex();
+  return _mutex != NULL;
+}
+
+bool ResponseCache::get(int16_t command, UserRole role, JsonVariant output)
+{
+  if (_mutex == NULL || xSemaphoreTake(_mutex, pdMS_TO_TICKS(50)) != pdTRUE)
+    return false;
+
+  bool found = false;
+  for (auto& entry : _entries) {
+    if (entry.command == command && entry.role == role) {
+      if ((int32_t)(entry.expires - millis()) > 0) {
+        for (JsonPairConst kv : entry.doc.as<JsonObjectConst>())
+          output[kv.key()] = kv.value();
+        found = true;
+      }
+      break;
+    }
+  }
+
+  if (found)
+    hits++;
+  else
+    misses++;
+
+  xSemaphoreGive(_mutex);
+  return found;
+}
+
+void ResponseCache::put(int16_t command, UserRole role, JsonVariantConst response, uint32_t ttl_ms)
+{
+  if (_mutex == NULL || xSemaphoreTake(_mutex, pdMS_TO_TICKS(50)) != pdTRUE)
+    return;
+
+  Entry* slot = nullptr;
+  for (auto& entry : _entries) {
+    if (entry.command == command && entry.role == role) {
+      slot = &entry;
+      break;
+    }
+  }
+
+  if (!slot) {
+    if (_entries.full()) {
+      // toss whatever expires first
+      slot = &_entries[0];
+      for (auto& entry : _entries)
+        if ((int32_t)(entry.expires - slot->expires) < 0)
+          slot = &entry;
+    } else {
+      _entries.emplace_back();
+      slot = &_entries.back();
+    }
+  }
+
+  slot->command = command;
+  slot->role = role;
+  slot->expires = millis() + ttl_ms;
+  slot->doc.set(response);
+
+  xSemaphoreGive(_mutex);
+}
+
+void ResponseCache::invalidate()
+{
+  // stale is worse than slow, so wait our turn
+  if (_mutex == NULL || xSemaphoreTake(_mutex, portMAX_DELAY) != pdTRUE)
+    return;
+
+  _entries.clear();
+
+  xSemaphoreGive(_mutex);
+}
+
+void ResponseCache::invalidate(int16_t command)
+{
+  if (_mutex == NULL || xSemaphoreTake(_mutex, portMAX_DELAY) != pdTRUE)
+    return;
+
+  for (size_t i = 0; i < _entries.size();) {
+    if (_entries[i].command == command)
+      _entries.erase(_entries.begin() + i);
+    else
+      i++;
+  }
+
+  xSemaphoreGive(_mutex);
+}
@@ -0,0 +1,61 @@
+/*
+ * Yarrboard Framework
+ *
+ * Copyright (c) 2025 Zach Hoeken <hoeken@gmail.com>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#ifndef YARR_RESPONSE_CACHE_H
+#define YARR_RESPONSE_CACHE_H
+
+#include "YarrboardConfig.h"
+#include "controllers/AuthController.h"
+#include <ArduinoJson.h>
+#include <etl/vector.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+/**
+ * ResponseCache
+ *
+ * Holds the output of read-only protocol commands (get_config and friends)
+ * keyed by command id + role, so a burst of identical requests only pays
+ * for generating it once.  Entries expire after their TTL, or when
+ * something calls invalidate() - ConfigManager::saveConfig() does.
+ *
+ * Responses are stored as documents rather than serialized bytes, since
+ * each reply still needs its own msgid and may go out as JSON or msgpack.
+ */
+class ResponseCache
+{
+  public:
+    uint32_t hits = 0;
+    uint32_t misses = 0;
+
+    bool begin();
+
+    // copies a fresh cached response into output, false on a miss
+    bool get(int16_t command, UserRole role, JsonVariant output);
+    void put(int16_t command, UserRole role, JsonVariantConst response, uint32_t ttl_ms);
+
+    void invalidate();
+    void invalidate(int16_t command);
+
+  private:
+    struct Entry {
+        int16_t command;
+        UserRole role;
+        uint32_t expires;
+        JsonDocument doc;
+    };
+
+    etl::vector<Entry, YB_RESPONSE_CACHE_SIZE> _entries;
+    SemaphoreHandle_t _mutex = NULL;
+};
+
+#endif /* !YARR_RESPONSE_CACHE_H */
@@ -12,42 +12,67 @@
 
 // RollingAverage.h
 #pragma once
-#include <Arduino.h>
+#include "YarrboardConfig.h"
+#include "YarrboardHAL.h"
+#include <math.h>
+#include <type_traits>
 
 /**
- * @brief RollingAverage maintains a running average of recent samples
+ * @brief RollingAverage maintains running statistics of recent samples
  *        collected within a given time window (in milliseconds).
  *
- * The class stores up to 'capacity' samples in a ring buffer. When new
- * samples are added, old ones that fall outside the specified window
- * (based on millis()) are automatically discarded.
+ * Up to N samples are stored inline in a ring buffer (no heap). When new
+ * samples are added, old ones that fall outside the window (based on
+ * millis()) are automatically discarded.
+ *
+ * Besides the average it tracks the window's min/max (monotonic queues, so
+ * O(1) amortized) and variance (Welford's algorithm, run in reverse when a
+ * sample leaves). The running sum uses a 64-bit (or double) accumulator,
+ * so large micros() deltas can't overflow it.
  *
  * Example:
- *   RollingAverage ra(128, 1000);  // 128-sample buffer, 1-second window
+ *   RollingAverage<uint32_t, 128> ra(1000);  // 128-sample buffer, 1-second window
  *   ra.add(analogRead(A0));
- *   unsigned int avg = ra.average();       // get average of last 1s of data
+ *   uint32_t avg = ra.average();             // get average of last 1s of data
+ *   auto s = ra.snapshot();                  // or everything at once
  */
+// the old non-template class took (capacity, window_ms), see the deduction guides below
+struct RollingAverageLegacyForm {
+};
+
+template <typename T = uint32_t, uint16_t N = RA_DEFAULT_SIZE>
 class RollingAverage
 {
+    static_assert(!std::is_same<T, RollingAverageLegacyForm>::value,
+      "RollingAverage is a template now: write RollingAverage<T, N> ra(window_ms), the capacity is N");
+    static_assert(N > 0, "RollingAverage needs room for at least one sample");
+
   public:
+    // wide enough that N samples of T can't overflow
+    using Acc = typename std::conditional<std::is_floating_point<T>::value, double,
+      typename std::conditional<std::is_signed<T>::value, int64_t, uint64_t>::type>::type;
+
+    struct Snapshot {
+        T average;
+        T min;
+        T max;
+        T latest;
+        float stddev;
+        uint16_t count;
+    };
+
     /**
-     * @param capacity  Maximum number of stored samples.
      * @param window_ms Time window in milliseconds over which to average.
      */
-    RollingAverage(uint16_t capacity, uint32_t window_ms = 1000)
-        : cap_(capacity ? capacity : 1), window_(window_ms)
-    {
-      buf_ = new Sample[cap_];
-    }
-
-    /** Destructor — frees allocated memory. */
-    ~RollingAverage() { delete[] buf_; }
+    RollingAverage(uint32_t window_ms = RA_DEFAULT_WINDOW) : window_(window_ms) {}
 
     /** Clear all stored samples and reset state. */
     inline void clear()
     {
       head_ = tail_ = count_ = 0;
+      minHead_ = minCount_ = maxHead_ = maxCount_ = 0;
       sum_ = 0;
+      mean_ = m2_ = 0;
     }
 
     /**
@@ -58,22 +83,35 @@ class RollingAverage
      *
      * @param v The sample value to add.
      */
-    inline void add(uint32_t v)
+    inline void add(T v)
     {
-      const uint32_t now = millis();
+      const uint32_t now = yb_millis();
       prune(now);
 
       // Drop oldest if buffer full
-      if (count_ == cap_) {
-        sum_ -= buf_[head_].v;
-        head_ = next(head_);
-        --count_;
-      }
+      if (count_ == N)
+        dropOldest();
 
-      buf_[tail_] = {v, now};
+      const uint16_t idx = tail_;
+      buf_[idx] = {v, now};
       tail_ = next(tail_);
       ++count_;
       sum_ += v;
+
+      // welford
+      const double x = (double)v;
+      const double delta = x - mean_;
+      mean_ += delta / count_;
+      m2_ += delta * (x - mean_);
+
+      // monotonic queues: drop anything the new sample makes irrelevant
+      while (minCount_ && !(buf_[minBack()].v < v))
+        --minCount_;
+      minQ_[(minHead_ + minCount_++) % N] = idx;
+
+      while (maxCount_ && !(buf_[maxBack()].v > v))
+        --maxCount_;
+      maxQ_[(maxHead_ + maxCount_++) % N] = idx;
     }
 
     /**
@@ -82,24 +120,44 @@ class RollingAverage
      * @param fast If true (default), use the precomputed running sum (fast).
      *             If false, recalculate the sum from scratch (slower but accurate
      *             if you've modified data manually or want to verify integrity).
-     * @return The average value, or 0. if no valid samples exist.
+     * @return The average value, or 0 if no valid samples exist.
      */
-    inline uint32_t average(bool fast = true)
+    inline T average(bool fast = true)
     {
-      prune(millis());
+      prune(yb_millis());
       if (!count_)
         return 0;
 
-      if (fast) {
-        return sum_ / count_;
-      } else {
-        uint32_t total = 0;
-        for (uint16_t i = 0, idx = head_; i < count_; ++i) {
-          total += buf_[idx].v;
-          idx = next(idx);
-        }
-        return total / count_;
+      if (fast)
+        return (T)(sum_ / count_);
+
+      Acc total = 0;
+      for (uint16_t i = 0, idx = head_; i < count_; ++i) {
+        total += buf_[idx].v;
+        idx = next(idx);
       }
+      return (T)(total / count_);
+    }
+
+    /** @brief Smallest sample in the window, or 0 if empty. */
+    inline T min()
+    {
+      prune(yb_millis());
+      return minCount_ ? buf_[minQ_[minHead_]].v : 0;
+    }
+
+    /** @brief Largest sample in the window, or 0 if empty. */
+    inline T max()
+    {
+      prune(yb_millis());
+      return maxCount_ ? buf_[maxQ_[maxHead_]].v : 0;
+    }
+
+    /** @brief Population standard deviation of the window. */
+    inline float stddev()
+    {
+      prune(yb_millis());
+      return currentStddev();
     }
 
     /**
@@ -107,13 +165,10 @@ class RollingAverage
      *
      * @return The latest value, or 0 if no samples exist.
      */
-    inline uint32_t latest()
+    inline T latest()
     {
-      prune(millis());
-      if (!count_)
-        return 0;
-      const uint16_t last = (tail_ == 0) ? (cap_ - 1) : (tail_ - 1);
-      return buf_[last].v;
+      prune(yb_millis());
+      return count_ ? buf_[prev(tail_)].v : 0;
     }
 
     /**
@@ -121,41 +176,103 @@ class RollingAverage
      */
     inline uint16_t count()
     {
-      prune(millis());
+      prune(yb_millis());
       return count_;
     }
 
     /**
-     * @brief Get the capacity of total samples.
+     * @brief All of the stats after a single prune.
      */
-    inline uint16_t cap()
+    inline Snapshot snapshot()
     {
-      return cap_;
+      prune(yb_millis());
+
+      Snapshot s = {};
+      s.count = count_;
+      if (!count_)
+        return s;
+
+      s.average = (T)(sum_ / count_);
+      s.min = buf_[minQ_[minHead_]].v;
+      s.max = buf_[maxQ_[maxHead_]].v;
+      s.latest = buf_[prev(tail_)].v;
+      s.stddev = currentStddev();
+      return s;
     }
 
+    /**
+     * @brief Get the capacity of total samples.
+     */
+    static constexpr uint16_t cap() { return N; }
+
     /**
      * @brief Get the window in ms
      */
-    inline uint32_t window()
-    {
-      return window_;
-    }
+    inline uint32_t window() const { return window_; }
 
   private:
     struct Sample {
-        uint32_t v; ///< Sample value
+        T v;        ///< Sample value
         uint32_t t; ///< Timestamp in milliseconds
     };
 
-    Sample* buf_ = nullptr;
-    uint16_t cap_ = 0;    ///< Max samples
+    Sample buf_[N];
     uint16_t head_ = 0;   ///< Index of oldest sample
     uint16_t tail_ = 0;   ///< Index for next write
     uint16_t count_ = 0;  ///< Current sample count
-    uint32_t sum_ = 0;    ///< Running sum for fast average
+    Acc sum_ = 0;         ///< Running sum for fast average
+    double mean_ = 0;     ///< Welford running mean
+    double m2_ = 0;       ///< Welford sum of squared deviations
     uint32_t window_ = 0; ///< Time window in ms
 
-    inline uint16_t next(uint16_t i) const { return (i + 1u == cap_) ? 0u : (i + 1u); }
+    // ring buffer indexes into buf_, oldest at the head
+    uint16_t minQ_[N];
+    uint16_t minHead_ = 0;
+    uint16_t minCount_ = 0;
+    uint16_t maxQ_[N];
+    uint16_t maxHead_ = 0;
+    uint16_t maxCount_ = 0;
+
+    static inline uint16_t next(uint16_t i) { return (i + 1u == N) ? 0u : (i + 1u); }
+    static inline uint16_t prev(uint16_t i) { return i ? i - 1u : N - 1u; }
+    inline uint16_t minBack() const { return minQ_[(minHead_ + minCount_ - 1) % N]; }
+    inline uint16_t maxBack() const { return maxQ_[(maxHead_ + maxCount_ - 1) % N]; }
+
+    inline float currentStddev() const
+    {
+      if (count_ < 2 || m2_ <= 0)
+        return 0;
+      return sqrtf((float)(m2_ / count_));
+    }
+
+    inline void dropOldest()
+    {
+      const uint16_t idx = head_;
+      const T v = buf_[idx].v;
+
+      if (minCount_ && minQ_[minHead_] == idx) {
+        minHead_ = next(minHead_);
+        --minCount_;
+      }
+      if (maxCount_ && maxQ_[maxHead_] == idx) {
+        maxHead_ = next(maxHead_);
+        --maxCount_;
+      }
+
+      sum_ -= v;
+      head_ = next(head_);
+      --count_;
+
+      // welford in reverse
+      if (!count_) {
+        mean_ = m2_ = 0;
+      } else {
+        const double x = (double)v;
+        const double oldMean = mean_;
+        mean_ = (mean_ * (count_ + 1) - x) / count_;
+        m2_ -= (x - oldMean) * (x - mean_);
+      }
+    }
 
     /**
      * @brief Remove samples older than the time window.
@@ -164,13 +281,12 @@ class RollingAverage
      */
     inline void prune(uint32_t now)
     {
-      while (count_) {
-        const Sample& s = buf_[head_];
-        if ((uint32_t)(now - s.t) <= window_)
-          break;
-        sum_ -= s.v;
-        head_ = next(head_);
-        --count_;
-      }
+      while (count_ && (uint32_t)(now - buf_[head_].t) > window_)
+        dropOldest();
     }
-};
\ No newline at end of file
+};
+
+// Without these, the old `RollingAverage ra(128)` would quietly deduce
+// RollingAverage<> with a 128ms window.  Spell out the arguments instead.
+RollingAverage(uint32_t) -> RollingAverage<RollingAverageLegacyForm>;
+RollingAverage(uint32_t, uint32_t) -> RollingAverage<RollingAverageLegacyForm>;
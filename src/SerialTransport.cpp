@@ -0,0 +1,232 @@
+/*
+ * Yarrboard Framework
+ *
+ * Copyright (c) 2025 Zach Hoeken <hoeken@gmail.com>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include "SerialTransport.h"
+
+bool SerialTransport::begin(Stream& stream, bool framed)
+{
+  _stream = &stream;
+  _framed = framed;
+  _delimiter = framed ? 0 : '\n';
+
+  if (_mutex == NULL)
+    _mutex = xSemaphoreCreateMutex();
+  return _mutex != NULL;
+}
+
+void SerialTransport::poll(MessageHandler handler)
+{
+  if (_stream == nullptr)
+    return;
+
+  // only take what is already sitting in the uart buffer
+  int available = _stream->available();
+  if (available > YB_SERIAL_RX_BUDGET)
+    available = YB_SERIAL_RX_BUDGET;
+
+  for (int i = 0; i < available; i++) {
+    int c = _stream->read();
+    if (c < 0)
+      break;
+
+    if (c == _delimiter) {
+      if (!_rxDiscard && _rxLen)
+        dispatch(handler);
+
+      _rxLen = 0;
+      _rxDiscard = false;
+    } else if (!_rxDiscard) {
+      // leave room for the null terminator
+      if (_rxLen < sizeof(_rx) - 1)
+        _rx[_rxLen++] = (char)c;
+      else {
+        rxOverflows++;
+        _rxDiscard = true;
+      }
+    }
+  }
+
+  flush();
+}
+
+void SerialTransport::dispatch(MessageHandler& handler)
+{
+  if (!_framed) {
+    // ignore \r\n line endings and blank lines
+    if (_rx[_rxLen - 1] == '\r')
+      _rxLen--;
+
+    if (_rxLen) {
+      _rx[_rxLen] = '\0';
+      handler(CHANNEL_JSON, _rx, _rxLen);
+    }
+    return;
+  }
+
+  uint8_t channel;
+  size_t len;
+  if (!FrameCodec::decode((uint8_t*)_rx, _rxLen, channel, len)) {
+    rxBadFrames++;
+    return;
+  }
+
+  // the host has nothing to say on the log channel
+  if (channel != CHANNEL_JSON && channel != CHANNEL_MSGPACK)
+    return;
+
+  handler((Channel)channel, _rx + 1, len);
+}
+
+bool SerialTransport::send(Channel channel, const char* data, size_t len)
+{
+  // worst case size on the wire
+  size_t needed = _framed ? FrameCodec::maxEncodedSize(len) : len + 1;
+
+  if (needed > sizeof(_tx)) {
+    txDropped++;
+    return false;
+  }
+
+  if (_mutex == NULL || xSemaphoreTake(_mutex, pdMS_TO_TICKS(10)) != pdTRUE) {
+    txDropped++;
+    return false;
+  }
+
+  // make room by throwing out old messages
+  while (sizeof(_tx) - _txUsed < needed) {
+    if (!dropOldest()) {
+      txDropped++;
+      xSemaphoreGive(_mutex);
+      return false;
+    }
+  }
+
+  enqueue(channel, data, len);
+
+  xSemaphoreGive(_mutex);
+
+  // get it started right away if the port has room
+  flush();
+
+  return true;
+}
+
+void SerialTransport::enqueue(Channel channel, const char* data, size_t len)
+{
+  size_t pos = (_txTail + _txUsed) % sizeof(_tx);
+  size_t written = 0;
+
+  auto put = [&](uint8_t b) {
+    _tx[pos] = b;
+    pos = (pos + 1) % sizeof(_tx);
+    written++;
+  };
+
+  if (!_framed) {
+    for (size_t i = 0; i < len; i++)
+      put(data[i]);
+    put('\n');
+    _txUsed += written;
+    return;
+  }
+
+  _txUsed += FrameCodec::encode(_tx, sizeof(_tx), pos, channel, (const uint8_t*)data, len);
+}
+
+size_t SerialTransport::write(uint8_t b)
+{
+  // YBP gets called from every task
+  if (_mutex == NULL || xSemaphoreTake(_mutex, pdMS_TO_TICKS(10)) != pdTRUE)
+    return 0;
+
+  if (b != '\n') {
+    if (b != '\r' && _logLen < sizeof(_log))
+      _log[_logLen++] = (char)b;
+    xSemaphoreGive(_mutex);
+    return 1;
+  }
+
+  // send() takes the lock too, so hand it a copy
+  char line[sizeof(_log)];
+  size_t len = _logLen;
+  memcpy(line, _log, len);
+  _logLen = 0;
+  xSemaphoreGive(_mutex);
+
+  if (len)
+    send(CHANNEL_LOG, line, len);
+
+  return 1;
+}
+
+void SerialTransport::flush()
+{
+  if (_stream == nullptr || _txUsed == 0)
+    return;
+
+  if (_mutex == NULL || xSemaphoreTake(_mutex, 0) != pdTRUE)
+    return;
+
+  int room = _stream->availableForWrite();
+  while (room > 0 && _txUsed) {
+    // keep track of where the current message ends
+    if (_txInFlight == 0)
+      _txInFlight = messageLength(_txTail);
+
+    size_t chunk = std::min({_txInFlight, sizeof(_tx) - _txTail, (size_t)room});
+    size_t written = _stream->write(_tx + _txTail, chunk);
+
+    _txTail = (_txTail + written) % sizeof(_tx);
+    _txUsed -= written;
+    _txInFlight -= written;
+    room -= written;
+
+    if (written < chunk)
+      break;
+  }
+
+  xSemaphoreGive(_mutex);
+}
+
+size_t SerialTransport::messageLength(size_t start) const
+{
+  // every queued message ends in the delimiter
+  size_t len = 0;
+  size_t queued = _txUsed - ((start - _txTail + sizeof(_tx)) % sizeof(_tx));
+  while (len < queued) {
+    if (_tx[(start + len) % sizeof(_tx)] == _delimiter)
+      return len + 1;
+    len++;
+  }
+
+  return len;
+}
+
+bool SerialTransport::dropOldest()
+{
+  // nothing left but the message we are halfway through sending
+  if (_txUsed == _txInFlight)
+    return false;
+
+  size_t start = (_txTail + _txInFlight) % sizeof(_tx);
+  size_t len = messageLength(start);
+
+  // slide the rest of the partly sent message forward over the dropped one
+  for (size_t i = _txInFlight; i > 0; i--)
+    _tx[(_txTail + len + i - 1) % sizeof(_tx)] = _tx[(_txTail + i - 1) % sizeof(_tx)];
+
+  _txTail = (_txTail + len) % sizeof(_tx);
+  _txUsed -= len;
+  txDropped++;
+
+  return true;
+}
@@ -0,0 +1,114 @@
+/*
+ * Yarrboard Framework
+ *
+ * Copyright (c) 2025 Zach Hoeken <hoeken@gmail.com>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#ifndef YARR_SERIAL_TRANSPORT_H
+#define YARR_SERIAL_TRANSPORT_H
+
+#include "FrameCodec.h"
+#include "YarrboardConfig.h"
+#include <Arduino.h>
+#include <algorithm>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <functional>
+
+/**
+ * SerialTransport
+ *
+ * Messages over a Stream, without ever blocking the loop:
+ * - poll() reads whatever bytes have arrived (up to YB_SERIAL_RX_BUDGET) and
+ *   hands each complete message to the handler.  Partial messages wait for
+ *   the next poll, ones longer than YB_SERIAL_RX_BUFFER_SIZE are dropped.
+ * - send() copies a message into a TX ring and writes out as much as the port
+ *   will take without waiting, poll() keeps draining it.  When the ring is
+ *   full the oldest queued messages are dropped to make room, since a stale
+ *   update is worth less than a fresh one.  A message that has started going
+ *   out is never dropped, so the host only ever sees whole messages.
+ *
+ * There are two wire formats:
+ * - lines: one JSON message per \n terminated line, logs are plain lines.
+ * - framed: each message is [channel][payload][crc16] COBS encoded and
+ *   terminated by a 0x00, see FrameCodec.  Bad frames are counted and skipped.
+ *
+ * It is also a Print, so YBP logs get queued as whole messages instead of
+ * landing in the middle of one: on the log channel in framed mode, as a
+ * line of their own in line mode.
+ *
+ * send() is safe to call from any task.
+ */
+class SerialTransport : public Print
+{
+  public:
+    enum Channel : uint8_t {
+      CHANNEL_JSON = 0,    // protocol messages as JSON
+      CHANNEL_MSGPACK = 1, // protocol messages as MessagePack
+      CHANNEL_LOG = 2      // plain text log lines, device to host only
+    };
+
+    typedef std::function<void(Channel channel, char* data, size_t len)> MessageHandler;
+
+    uint32_t rxOverflows = 0;
+    uint32_t rxBadFrames = 0;
+    uint32_t txDropped = 0;
+
+    bool begin(Stream& stream, bool framed = false);
+    bool isFramed() const { return _framed; }
+
+    // read input, dispatch complete messages, then write out queued output
+    void poll(MessageHandler handler);
+
+    // queue one message, the newline or framing is added for you
+    bool send(Channel channel, const char* data, size_t len);
+    bool send(const char* data, size_t len) { return send(CHANNEL_JSON, data, len); }
+    bool send(const char* data) { return send(CHANNEL_JSON, data, strlen(data)); }
+
+    // push out as much queued output as the port can take right now
+    void flush();
+
+    size_t txQueued() const { return _txUsed; }
+
+    // input left over after the rx budget, or output the port has room for now
+    bool hasWork(bool reading)
+    {
+      if (_stream == nullptr)
+        return false;
+      return (reading && _stream->available() > 0) || (_txUsed && _stream->availableForWrite() > 0);
+    }
+
+    // log output, queued a line at a time
+    size_t write(uint8_t b) override;
+
+  private:
+    Stream* _stream = nullptr;
+    SemaphoreHandle_t _mutex = NULL;
+    bool _framed = false;
+    uint8_t _delimiter = '\n';
+
+    char _rx[YB_SERIAL_RX_BUFFER_SIZE];
+    size_t _rxLen = 0;
+    bool _rxDiscard = false;
+
+    uint8_t _tx[YB_SERIAL_TX_BUFFER_SIZE];
+    size_t _txTail = 0;     // next byte to write to the port
+    size_t _txUsed = 0;     // bytes queued
+    size_t _txInFlight = 0; // unsent bytes of a message that is partly written, 0 = none
+
+    char _log[YB_SERIAL_LOG_LINE_LENGTH];
+    size_t _logLen = 0;
+
+    void dispatch(MessageHandler& handler);
+    void enqueue(Channel channel, const char* data, size_t len);
+    size_t messageLength(size_t start) const;
+    bool dropOldest();
+};
+
+#endif /* !YARR_SERIAL_TRANSPORT_H */
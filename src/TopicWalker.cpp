@@ -0,0 +1,174 @@
+/*
+ * Yarrboard Framework
+ *
+ * Copyright (c) 2025 Zach Hoeken <hoeken@gmail.com>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include "TopicWalker.h"
+#include <cstdio>
+#include <cstring>
+
+void TopicWalker::walk(JsonVariantConst node, const char* prefix, Callback callback, void* context)
+{
+  char topicBuf[TOPIC_CAP];
+  snprintf(topicBuf, TOPIC_CAP, "%s", prefix ? prefix : "");
+  size_t len = strlen(topicBuf);
+
+  walkImpl(node, topicBuf, TOPIC_CAP, len, callback, context);
+}
+
+void TopicWalker::append(char* buf, size_t& len, size_t cap, const char* piece)
+{
+  if (!piece || !piece[0])
+    return;
+  // Add separator if we already have content
+  if (len > 0 && buf[len - 1] != '/' && len + 1 < cap) {
+    buf[len++] = '/';
+  }
+  // Append piece (truncate safely if needed)
+  while (*piece && len + 1 < cap) {
+    buf[len++] = *piece++;
+  }
+  buf[len] = '\0';
+}
+
+void TopicWalker::appendIndex(char* buf, size_t& len, size_t cap, size_t index)
+{
+  char ibuf[16];
+  // Enough for size_t up to 64-bit
+  int n = snprintf(ibuf, sizeof(ibuf), "%u", static_cast<unsigned>(index));
+  (void)n; // silence -Wunused-result
+  append(buf, len, cap, ibuf);
+}
+
+// Convert a primitive JsonVariant to char* payload without String
+const char* TopicWalker::toPayload(JsonVariantConst v, char* out, size_t outcap)
+{
+  if (v.isNull()) {
+    // Publish literal "null"
+    if (outcap > 0) {
+      strncpy(out, "null", outcap - 1);
+      out[outcap - 1] = '\0';
+      return out;
+    }
+    return "";
+  }
+
+  // Strings: publish raw C-string (no extra quotes)
+  if (v.is<const char*>()) {
+    const char* s = v.as<const char*>();
+    if (!s)
+      return "";
+    // Copy into out so caller owns stable storage
+    if (outcap > 0) {
+      strncpy(out, s, outcap - 1);
+      out[outcap - 1] = '\0';
+      return out;
+    }
+    return "";
+  }
+
+  // Booleans
+  if (v.is<bool>()) {
+    const char* s = v.as<bool>() ? "true" : "false";
+    if (outcap > 0) {
+      strncpy(out, s, outcap - 1);
+      out[outcap - 1] = '\0';
+      return out;
+    }
+    return "";
+  }
+
+  // Integers (prefer widest to avoid overflow)
+  if (v.is<long long>()) {
+    (void)snprintf(out, outcap, "%lld", v.as<long long>());
+    return out;
+  }
+  if (v.is<unsigned long long>()) {
+    (void)snprintf(out, outcap, "%llu", v.as<unsigned long long>());
+    return out;
+  }
+  if (v.is<long>()) {
+    (void)snprintf(out, outcap, "%ld", v.as<long>());
+    return out;
+  }
+  if (v.is<unsigned long>()) {
+    (void)snprintf(out, outcap, "%lu", v.as<unsigned long>());
+    return out;
+  }
+  if (v.is<int>()) {
+    (void)snprintf(out, outcap, "%d", v.as<int>());
+    return out;
+  }
+  if (v.is<unsigned int>()) {
+    (void)snprintf(out, outcap, "%u", v.as<unsigned int>());
+    return out;
+  }
+
+  // Floating point
+  if (v.is<double>()) {
+    // %.9g gives compact form while preserving good precision
+    (void)snprintf(out, outcap, "%.9g", v.as<double>());
+    return out;
+  }
+  if (v.is<float>()) {
+    (void)snprintf(out, outcap, "%.7g", v.as<float>());
+    return out;
+  }
+
+  // Fallback: serialize JSON representation into out (covers other primitive-ish cases)
+  // (This will include quotes for strings, but we already handled strings above.)
+  serializeJson(v, out, outcap);
+  return out;
+}
+
+// Depth-first traversal with an in-place topic buffer
+void TopicWalker::walkImpl(JsonVariantConst node, char* topicBuf, size_t cap, size_t curLen, Callback callback, void* context)
+{
+  // Objects
+  if (node.is<JsonObjectConst>()) {
+    JsonObjectConst obj = node.as<JsonObjectConst>();
+    for (JsonPairConst kv : obj) { // ArduinoJson v7-compatible
+      // Save current length so we can restore after recursion
+      size_t savedLen = curLen;
+
+      // Append key
+      append(topicBuf, curLen, cap, kv.key().c_str());
+
+      // Recurse
+      walkImpl(kv.value(), topicBuf, cap, curLen, callback, context);
+
+      // Restore topic
+      curLen = savedLen;
+      topicBuf[curLen] = '\0';
+    }
+    return;
+  }
+
+  // Arrays
+  if (node.is<JsonArrayConst>()) {
+    JsonArrayConst arr = node.as<JsonArrayConst>();
+    size_t idx = 0;
+    for (JsonVariantConst v : arr) {
+      size_t savedLen = curLen;
+      appendIndex(topicBuf, curLen, cap, idx++);
+      walkImpl(v, topicBuf, cap, curLen, callback, context);
+      curLen = savedLen;
+      topicBuf[curLen] = '\0';
+    }
+    return;
+  }
+
+  // Primitive leaf -> publish
+  char payload[PAYLOAD_CAP];
+  const char* data = toPayload(node, payload, sizeof(payload));
+
+  // Ensure non-null topic string (can be empty if caller passed "")
+  callback(context, topicBuf, data);
+}
@@ -0,0 +1,54 @@
+/*
+ * Yarrboard Framework
+ *
+ * Copyright (c) 2025 Zach Hoeken <hoeken@gmail.com>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#ifndef YARR_TOPIC_WALKER_H
+#define YARR_TOPIC_WALKER_H
+
+#include <ArduinoJson.h>
+#include <stddef.h>
+
+/**
+ * TopicWalker
+ *
+ * Flattens a JSON document into one (topic, payload) pair per leaf, the way
+ * MQTTController publishes channel updates:
+ *
+ *   {"duty": 0.5, "state": [true, false]} under "pwm/1"
+ *
+ *   pwm/1/duty     0.5
+ *   pwm/1/state/0  true
+ *   pwm/1/state/1  false
+ *
+ * Strings go out without quotes.  The topic is built in place in a fixed
+ * buffer, so nothing is allocated.  No hardware in here either, so it
+ * builds natively for the tests and benchmarks.
+ */
+class TopicWalker
+{
+  public:
+    typedef void (*Callback)(void* context, const char* topic, const char* payload);
+
+    static constexpr size_t TOPIC_CAP = 256;
+    static constexpr size_t PAYLOAD_CAP = 256;
+
+    static void walk(JsonVariantConst node, const char* prefix, Callback callback, void* context);
+
+    // Convert a primitive JsonVariant to char* payload without String
+    static const char* toPayload(JsonVariantConst v, char* out, size_t outcap);
+
+  private:
+    static void append(char* buf, size_t& len, size_t cap, const char* piece);
+    static void appendIndex(char* buf, size_t& len, size_t cap, size_t index);
+    static void walkImpl(JsonVariantConst node, char* topicBuf, size_t cap, size_t curLen, Callback callback, void* context);
+};
+
+#endif /* !YARR_TOPIC_WALKER_H */
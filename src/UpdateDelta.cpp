@@ -0,0 +1,238 @@
+/*
+ * Yarrboard Framework
+ *
+ * Copyright (c) 2025 Zach Hoeken <hoeken@gmail.com>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include "UpdateDelta.h"
+#include "YarrboardHAL.h"
+#include <cstdlib>
+#include <cstring>
+
+UpdateDelta::~UpdateDelta()
+{
+  for (Client& c : _clients)
+    free(c.hashes);
+}
+
+void UpdateDelta::generate(uint8_t mode, uint32_t clientId, uint32_t clientSeq, JsonVariantConst update, JsonVariant output)
+{
+  YarrboardLock lock(_mutex);
+
+  Client* client = getClient(mode, clientId);
+
+  // out of memory, just send it all
+  if (client == nullptr) {
+    output.set(update);
+    output["seq"] = _nextSeq++;
+    return;
+  }
+
+  size_t leaves = 0;
+  uint32_t shape = shapeOf(update, 2166136261u, leaves);
+
+  // too big to track, same deal
+  if (leaves > YB_DELTA_MAX_FIELDS) {
+    client->valid = false;
+    output.set(update);
+    output["seq"] = _nextSeq++;
+    return;
+  }
+
+  size_t idx = 0;
+  bool full = !client->valid || clientSeq != client->seq || shape != client->shape;
+
+  if (full) {
+    compare(update, client->hashes, idx);
+    output.set(update);
+  } else {
+    diffObject(update, output.to<JsonObject>(), client->hashes, idx);
+    output["msg"] = update["msg"];
+    output["delta"] = true;
+  }
+
+  client->valid = true;
+  client->shape = shape;
+  client->seq = _nextSeq++;
+  output["seq"] = client->seq;
+}
+
+void UpdateDelta::forget(uint8_t mode, uint32_t clientId)
+{
+  YarrboardLock lock(_mutex);
+
+  // the hashes stay allocated for the next client
+  for (Client& c : _clients)
+    if (c.hashes && c.mode == mode && c.clientId == clientId)
+      c.valid = false;
+}
+
+UpdateDelta::Client* UpdateDelta::getClient(uint8_t mode, uint32_t clientId)
+{
+  Client* oldest = nullptr;
+  for (Client& c : _clients) {
+    if (c.hashes && c.mode == mode && c.clientId == clientId) {
+      c.lastUsed = yb_millis();
+      return &c;
+    }
+
+    // free slots beat everything, then least recently used
+    if (!oldest || (oldest->hashes && (!c.hashes || (int32_t)(c.lastUsed - oldest->lastUsed) < 0)))
+      oldest = &c;
+  }
+
+  if (!oldest->hashes) {
+    oldest->hashes = (uint32_t*)malloc(YB_DELTA_MAX_FIELDS * sizeof(uint32_t));
+    if (!oldest->hashes)
+      return nullptr;
+  }
+
+  oldest->mode = mode;
+  oldest->clientId = clientId;
+  oldest->valid = false;
+  oldest->seq = 0;
+  oldest->lastUsed = yb_millis();
+  return oldest;
+}
+
+// walk everything and store the hashes, true if any leaf changed
+bool UpdateDelta::compare(JsonVariantConst src, uint32_t* hashes, size_t& idx)
+{
+  bool changed = false;
+
+  if (src.is<JsonObjectConst>()) {
+    for (JsonPairConst kv : src.as<JsonObjectConst>())
+      changed |= compare(kv.value(), hashes, idx);
+  } else if (src.is<JsonArrayConst>()) {
+    for (JsonVariantConst v : src.as<JsonArrayConst>())
+      changed |= compare(v, hashes, idx);
+  } else {
+    uint32_t hash = hashLeaf(src);
+    changed = hashes[idx] != hash;
+    hashes[idx++] = hash;
+  }
+
+  return changed;
+}
+
+bool UpdateDelta::diffObject(JsonObjectConst src, JsonObject dst, uint32_t* hashes, size_t& idx)
+{
+  bool changed = false;
+
+  for (JsonPairConst kv : src) {
+    JsonVariantConst value = kv.value();
+
+    if (value.is<JsonObjectConst>()) {
+      if (diffObject(value, dst[kv.key()].to<JsonObject>(), hashes, idx))
+        changed = true;
+      else
+        dst.remove(kv.key());
+    } else if (value.is<JsonArrayConst>()) {
+      if (diffArray(value, dst[kv.key()].to<JsonArray>(), hashes, idx))
+        changed = true;
+      else
+        dst.remove(kv.key());
+    } else if (compare(value, hashes, idx)) {
+      dst[kv.key()] = value;
+      changed = true;
+    }
+  }
+
+  // so the client knows what to merge it into
+  if (changed && !src["id"].isNull())
+    dst["id"] = src["id"];
+
+  return changed;
+}
+
+bool UpdateDelta::diffArray(JsonArrayConst src, JsonArray dst, uint32_t* hashes, size_t& idx)
+{
+  bool byId = true;
+  for (JsonVariantConst v : src) {
+    if (v["id"].isNull()) {
+      byId = false;
+      break;
+    }
+  }
+
+  // no ids, so positions matter and we have to send the whole thing
+  if (!byId) {
+    if (!compare(src, hashes, idx))
+      return false;
+
+    for (JsonVariantConst v : src)
+      dst.add(v);
+    return true;
+  }
+
+  bool changed = false;
+  for (JsonVariantConst v : src) {
+    if (diffObject(v, dst.add<JsonObject>(), hashes, idx))
+      changed = true;
+    else
+      dst.remove(dst.size() - 1);
+  }
+
+  return changed;
+}
+
+uint32_t UpdateDelta::shapeOf(JsonVariantConst src, uint32_t hash, size_t& leaves)
+{
+  if (src.is<JsonObjectConst>()) {
+    hash = fnv("{", 1, hash);
+    for (JsonPairConst kv : src.as<JsonObjectConst>()) {
+      hash = fnv(kv.key().c_str(), kv.key().size(), hash);
+      hash = shapeOf(kv.value(), hash, leaves);
+    }
+    return fnv("}", 1, hash);
+  }
+
+  if (src.is<JsonArrayConst>()) {
+    hash = fnv("[", 1, hash);
+    for (JsonVariantConst v : src.as<JsonArrayConst>())
+      hash = shapeOf(v, hash, leaves);
+    return fnv("]", 1, hash);
+  }
+
+  leaves++;
+  return fnv(".", 1, hash);
+}
+
+uint32_t UpdateDelta::hashLeaf(JsonVariantConst src)
+{
+  if (src.is<const char*>()) {
+    const char* str = src.as<const char*>();
+    return fnv(str, strlen(str), fnv("s", 1));
+  }
+
+  if (src.is<bool>())
+    return fnv(src.as<bool>() ? "t" : "f", 1);
+
+  if (src.is<long long>()) {
+    long long value = src.as<long long>();
+    return fnv(&value, sizeof(value), fnv("i", 1));
+  }
+
+  if (src.is<double>()) {
+    double value = src.as<double>();
+    return fnv(&value, sizeof(value), fnv("d", 1));
+  }
+
+  return fnv("n", 1);
+}
+
+uint32_t UpdateDelta::fnv(const void* data, size_t len, uint32_t hash)
+{
+  const uint8_t* bytes = (const uint8_t*)data;
+  for (size_t i = 0; i < len; i++) {
+    hash ^= bytes[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
@@ -0,0 +1,75 @@
+/*
+ * Yarrboard Framework
+ *
+ * Copyright (c) 2025 Zach Hoeken <hoeken@gmail.com>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#ifndef YARR_UPDATE_DELTA_H
+#define YARR_UPDATE_DELTA_H
+
+#include "YarrboardConfig.h"
+#include "YarrboardHAL.h"
+#include <ArduinoJson.h>
+
+/**
+ * UpdateDelta
+ *
+ * Turns a full update message into just the fields that changed since the
+ * last one a given client received.  For each client we keep a hash of
+ * every leaf value, in walk order, plus a hash of the document's shape.
+ *
+ * Objects inside arrays are matched up by their "id" field, and a changed
+ * object always carries its id.  Arrays without ids are sent whole when
+ * anything in them changes.
+ *
+ * Every reply gets a new, server-wide increasing "seq".  The client echoes
+ * back the last seq it applied; if that isn't what we sent it last, or the
+ * shape of the update changed (channels added, etc), it gets a full update.
+ *
+ * generate() and forget() are safe to call from different tasks (the
+ * protocol task and the httpd close handler).
+ */
+class UpdateDelta
+{
+  public:
+    ~UpdateDelta();
+
+    // Writes a delta (or a full update if needed) of `update` into `output`.
+    void generate(uint8_t mode, uint32_t clientId, uint32_t clientSeq, JsonVariantConst update, JsonVariant output);
+
+    // Call when a client goes away, its next request will get a full update.
+    void forget(uint8_t mode, uint32_t clientId);
+
+  private:
+    struct Client {
+        uint8_t mode;
+        uint32_t clientId;
+        bool valid;      // hashes match what this client has
+        uint32_t seq;    // last seq we sent
+        uint32_t shape;  // shape hash of the last update
+        uint32_t lastUsed;
+        uint32_t* hashes; // YB_DELTA_MAX_FIELDS leaf hashes
+    };
+
+    Client _clients[YB_DELTA_MAX_CLIENTS] = {};
+    uint32_t _nextSeq = 1;
+    YarrboardMutex _mutex;
+
+    Client* getClient(uint8_t mode, uint32_t clientId);
+
+    bool compare(JsonVariantConst src, uint32_t* hashes, size_t& idx);
+    bool diffObject(JsonObjectConst src, JsonObject dst, uint32_t* hashes, size_t& idx);
+    bool diffArray(JsonArrayConst src, JsonArray dst, uint32_t* hashes, size_t& idx);
+
+    static uint32_t shapeOf(JsonVariantConst src, uint32_t hash, size_t& leaves);
+    static uint32_t hashLeaf(JsonVariantConst src);
+    static uint32_t fnv(const void* data, size_t len, uint32_t hash = 2166136261u);
+};
+
+#endif /* !YARR_UPDATE_DELTA_H */
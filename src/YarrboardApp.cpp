@@ -12,6 +12,7 @@
 
 #include "YarrboardApp.h"
 #include "YarrboardDebug.h"
+#include "YarrboardTrace.h"
 
 YarrboardApp::YarrboardApp() : config(*this),
                                debug(*this),
@@ -23,30 +24,69 @@ YarrboardApp::YarrboardApp() : config(*this),
                                ota(*this),
                                ntp(*this),
                                networkLogger(protocol),
-                               loopSpeed(100, 1000),
-                               framerateAvg(10, 10000)
+                               loopSpeed(1000),
+                               framerateAvg(10000)
 
 {
-  registerController(debug, 10);
+  // group 0 is the Arduino loop() task
+  _groups[0].app = this;
+  _groups[0].name = "main";
+
+  // nothing built in runs every pass, so idle mode can actually sleep.
+  // the queues and callbacks signal() their controller when work shows up,
+  // the periods only cover polling (wifi state, serial, ArduinoOTA, timeouts)
+  registerController(debug, 10, ControllerSchedule(60000));
   registerController(config, 20);
-  registerController(network, 30);
+  registerController(network, 30, ControllerSchedule(50, 0, true));
   registerController(ntp, 40);
-  registerController(http, 50);
-  registerController(protocol, 60);
+  registerController(http, 50, ControllerSchedule(100, 0, true));
+  registerController(protocol, 60, ControllerSchedule(10, 0, true));
   registerController(auth, 70);
-  registerController(ota, 80);
-  registerController(mqtt, 200);
+  registerController(ota, 80, ControllerSchedule(100, 0, true));
+  // mqtt publishing can always wait a pass when we're busy
+  ControllerSchedule mqttSchedule(1000, 0, true);
+  mqttSchedule.deferrable = true;
+  registerController(mqtt, 200, mqttSchedule);
 }
 
 void YarrboardApp::setup()
 {
-  for (const ControllerEntry& entry : _controllers) {
-    if (entry.controller->start())
-      YBP.printf("✅ %s setup OK\n", entry.controller->getName());
-    else
-      YBP.printf("❌ %s setup FAILED\n", entry.controller->getName());
+  int64_t setupStart = esp_timer_get_time();
+
+  // before anything starts making messages
+  if (!jsonPool.begin())
+    YBP.println("⚠️ Unable to allocate the json pool, using the heap");
+
+  // so wake() can find the Arduino loop task
+  _groups[0].task = xTaskGetCurrentTaskHandle();
+
+  // move our network facing controllers off the loop() task
+  if (use_network_task) {
+    int group = addTaskGroup("network", network_task_core);
+    if (group > 0) {
+      setControllerGroup("http", group);
+      setControllerGroup("protocol", group);
+      setControllerGroup("mqtt", group);
+      setControllerGroup("ota", group);
+    } else
+      YBP.println("❌ Unable to create network task group");
+  }
+
+  // anything still waiting (usually on wifi) gets started from loop()
+  for (ControllerEntry& entry : _controllers) {
+    if (_needsMet(entry.controller->getNeeds()))
+      _startController(entry);
+    else {
+      entry.pending = true;
+      _pendingCount++;
+      YBP.printf("⏳ %s waiting to start\n", entry.controller->getName());
+    }
   }
 
+  recordBootEvent("setup", setupStart);
+  if (!_pendingCount)
+    recordBootEvent("ready", esp_timer_get_time());
+
   // we're done with startup log
   YBP.removePrinter(startupLogger);
 
@@ -77,13 +117,9 @@ void YarrboardApp::_handleImprov()
     config.saveConfig(error, sizeof(error));
 
     YBP.println("Re-starting failed controllers.");
-    for (const ControllerEntry& entry : _controllers) {
-      if (!entry.controller->isStarted()) {
-        if (entry.controller->start())
-          YBP.printf("✅ %s setup OK\n", entry.controller->getName());
-        else
-          YBP.printf("❌ %s setup FAILED\n", entry.controller->getName());
-      }
+    for (ControllerEntry& entry : _controllers) {
+      if (!entry.controller->isStarted())
+        _startController(entry);
     }
 
     // we're totally done now.
@@ -100,13 +136,23 @@ void YarrboardApp::loop()
     return;
   }
 
+  // our other task groups only start once we're done with first boot
+  if (!_groupsStarted)
+    _startTaskGroups();
+
+  // start anything whose dependencies just came up
+  if (_pendingCount)
+    _startPending();
+
+#ifndef YB_DISABLE_PROBES
   // start our interval timer
   debug.it.start();
+#endif
 
-  for (const ControllerEntry& entry : _controllers) {
-    entry.controller->loop();
-    debug.it.time(entry.controller->getName());
-  }
+  _runGroup(_groups[0]);
+
+  if (enable_idle_mode)
+    _idleGroup(_groups[0]);
 
   // calculate our framerate
   unsigned long loopDelta = micros() - lastLoopMicros;
@@ -118,14 +164,345 @@ void YarrboardApp::loop()
   if (millis() - lastLoopMillis > 1000) {
     framerateAvg.add(framerate_now);
     framerate = framerateAvg.average();
+    _updateBusyPercent((millis() - lastLoopMillis) * 1000);
     lastLoopMillis = millis();
   }
 }
 
+bool YarrboardApp::_needsMet(uint8_t needs)
+{
+  if ((needs & YB_NEEDS_CONFIG) && !config.isStarted())
+    return false;
+
+  if ((needs & YB_NEEDS_WIFI) && !network.isWifiReady())
+    return false;
+
+  return true;
+}
+
+void YarrboardApp::_startController(ControllerEntry& entry)
+{
+  if (entry.pending) {
+    entry.pending = false;
+    _pendingCount--;
+  }
+
+  int64_t start = esp_timer_get_time();
+  bool ok = entry.controller->start();
+  recordBootEvent(entry.controller->getName(), start, ok);
+
+  if (ok)
+    YBP.printf("✅ %s setup OK\n", entry.controller->getName());
+  else
+    YBP.printf("❌ %s setup FAILED\n", entry.controller->getName());
+}
+
+void YarrboardApp::_startPending()
+{
+  for (ControllerEntry& entry : _controllers) {
+    if (entry.pending && _needsMet(entry.controller->getNeeds()))
+      _startController(entry);
+  }
+
+  // the time to a fully running board
+  if (!_pendingCount)
+    recordBootEvent("ready", esp_timer_get_time());
+}
+
+void YarrboardApp::recordBootEvent(const char* name, int64_t start_us, bool ok)
+{
+  if (_bootTimeline.full())
+    return;
+
+  _bootTimeline.push_back({name, start_us, (uint32_t)(esp_timer_get_time() - start_us), ok});
+}
+
+void YarrboardApp::generateBootTimeline(JsonVariant output)
+{
+  JsonArray timeline = output.to<JsonArray>();
+  for (const BootEvent& event : _bootTimeline) {
+    JsonObject jo = timeline.add<JsonObject>();
+    jo["name"] = event.name;
+    jo["start_us"] = event.start_us;
+    jo["duration_us"] = event.duration_us;
+    jo["ok"] = event.ok;
+  }
+}
+
+void YarrboardApp::generateTaskGroupStats(JsonVariant output)
+{
+  JsonArray groups = output.to<JsonArray>();
+  for (size_t i = 0; i < _groupCount; i++) {
+    JsonObject jo = groups.add<JsonObject>();
+    jo["name"] = _groups[i].name;
+    jo["core"] = _groups[i].core;
+    jo["busy_percent"] = _groups[i].busy_percent;
+  }
+}
+
+bool YarrboardApp::_idleGroup(TaskGroup& group)
+{
+  // every-pass controllers are due all the time, sleeping would just slow them down
+  if (group.scheduler.everyPassCount())
+    return false;
+
+  uint32_t wait = group.scheduler.msUntilNextDeadline(millis());
+  if (wait > YB_IDLE_MAX_WAIT_MS)
+    wait = YB_IDLE_MAX_WAIT_MS;
+
+  // block until the deadline or until someone calls wake()
+  uint32_t start = micros();
+  ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait));
+  group.idle_us += micros() - start;
+
+  return true;
+}
+
+void YarrboardApp::_updateBusyPercent(uint32_t window_us)
+{
+  if (!window_us)
+    return;
+
+  for (size_t i = 0; i < _groupCount; i++) {
+    TaskGroup& group = _groups[i];
+
+    uint32_t idle = group.idle_us.exchange(0);
+    if (idle > window_us)
+      idle = window_us;
+
+    group.busy_percent = 100 - (uint64_t)idle * 100 / window_us;
+  }
+
+  busy_percent = _groups[0].busy_percent;
+}
+
+void YarrboardApp::wake()
+{
+  for (size_t i = 0; i < _groupCount; i++) {
+    if (_groups[i].task)
+      xTaskNotifyGive(_groups[i].task);
+  }
+}
+
+void IRAM_ATTR YarrboardApp::wakeFromISR()
+{
+  BaseType_t woken = pdFALSE;
+
+  for (size_t i = 0; i < _groupCount; i++) {
+    if (_groups[i].task)
+      vTaskNotifyGiveFromISR(_groups[i].task, &woken);
+  }
+
+  if (woken)
+    portYIELD_FROM_ISR();
+}
+
+int YarrboardApp::_currentGroup()
+{
+  TaskHandle_t self = xTaskGetCurrentTaskHandle();
+  for (size_t i = 0; i < _groupCount; i++) {
+    if (_groups[i].task == self)
+      return i;
+  }
+
+  // httpd, mqtt, the async worker, etc.
+  return -1;
+}
+
+void YarrboardApp::_callInGroup(uint8_t group, GroupCall& call)
+{
+  TaskGroup& target = _groups[group];
+  int current = _currentGroup();
+
+  // tasks outside the groups are never waited on, so they can always wait
+  bool wait = _groupsStarted && target.task != nullptr && target.calls != NULL &&
+              current != group && (current < 0 || group < current);
+
+  if (!wait)
+    return call.fn(call.arg);
+
+  call.waiter = xTaskGetCurrentTaskHandle();
+  GroupCall* ptr = &call;
+  xQueueSend(target.calls, &ptr, portMAX_DELAY);
+  xTaskNotifyGive(target.task);
+
+  // a wake() can land here too, so make sure it's really done
+  while (!call.done)
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+}
+
+void YarrboardApp::_runGroupCalls(TaskGroup& group)
+{
+  GroupCall* call;
+  while (xQueueReceive(group.calls, &call, 0) == pdTRUE) {
+    // the call lives on the waiter's stack, don't touch it once it's done
+    TaskHandle_t waiter = call->waiter;
+    call->fn(call->arg);
+    call->done = true;
+    xTaskNotifyGive(waiter);
+  }
+}
+
+void YarrboardApp::_runGroup(TaskGroup& group)
+{
+  // hooks and commands other tasks handed us
+  if (group.calls != NULL)
+    _runGroupCalls(group);
+
+  // cross group hooks are handed off here so they run in the owning task
+  if (group.brightnessPending.exchange(false)) {
+    float brightness = config.globalBrightness;
+    for (const ControllerEntry& entry : _controllers) {
+      if ((entry.hooks & YB_HOOK_BIT(YB_HOOK_BRIGHTNESS)) && &_groups[entry.schedule.group] == &group)
+        entry.controller->updateBrightnessHook(brightness);
+    }
+  }
+
+  // Controllers stay in the scheduler from registration on, but loop() only
+  // runs once setup() succeeded.  Ones waiting on their needs or that failed
+  // setup() are skipped until _startPending() or first boot starts them.
+
+  // only the main group feeds the interval timer, it is not thread safe.
+  if (&group == &_groups[0]) {
+    group.scheduler.run(millis(), loop_budget_us, [this](BaseController* controller) {
+      if (!controller->isStarted())
+        return;
+      YB_TRACE_SCOPE(controller->getName());
+      controller->loop();
+#ifndef YB_DISABLE_PROBES
+      debug.it.time(controller->getTiming().probe);
+#endif
+    });
+  } else {
+    group.scheduler.run(millis(), loop_budget_us, [](BaseController* controller) {
+      if (!controller->isStarted())
+        return;
+      YB_TRACE_SCOPE(controller->getName());
+      controller->loop();
+    });
+  }
+}
+
+void YarrboardApp::_taskGroupLoop(void* pv)
+{
+  TaskGroup* group = (TaskGroup*)pv;
+
+  while (true) {
+    group->app->_runGroup(*group);
+
+    // let lower priority tasks (and the idle watchdog) have a turn
+    if (!group->app->enable_idle_mode || !group->app->_idleGroup(*group))
+      vTaskDelay(1);
+  }
+}
+
+void YarrboardApp::_startTaskGroups()
+{
+  for (size_t i = 0; i < _groupCount; i++) {
+    _groups[i].calls = xQueueCreate(YB_GROUP_CALL_QUEUE_SIZE, sizeof(GroupCall*));
+    if (_groups[i].calls == NULL)
+      YBP.printf("❌ %s task group has no call queue, hooks will run on the caller\n", _groups[i].name);
+  }
+
+  _groupsStarted = true;
+
+  for (size_t i = 1; i < _groupCount; i++) {
+    TaskGroup& group = _groups[i];
+
+    BaseType_t result = xTaskCreatePinnedToCore(
+      _taskGroupLoop,
+      group.name,
+      group.stack_size,
+      &group,
+      group.priority,
+      &group.task,
+      group.core);
+
+    if (result == pdPASS)
+      YBP.printf("✅ %s task started on core %d\n", group.name, group.core);
+    else
+      YBP.printf("❌ %s task failed to start\n", group.name);
+  }
+}
+
+int YarrboardApp::addTaskGroup(const char* name, int core, UBaseType_t priority, uint32_t stack_size)
+{
+  if (_groupsStarted || _groupCount >= _groups.size())
+    return -1;
+
+  // single core chips can't pin to core 1
+  if (core < 0 || core >= portNUM_PROCESSORS)
+    core = tskNO_AFFINITY;
+
+  TaskGroup& group = _groups[_groupCount];
+  group.app = this;
+  group.name = name;
+  group.core = core;
+  group.priority = priority;
+  group.stack_size = stack_size;
+
+  return _groupCount++;
+}
+
+bool YarrboardApp::setControllerGroup(const char* name, uint8_t group)
+{
+  for (ControllerEntry& entry : _controllers) {
+    if (entry.controller && entry.controller->getName() && (std::strcmp(entry.controller->getName(), name) == 0)) {
+      if (entry.schedule.group == group)
+        return true;
+
+      ControllerSchedule schedule = entry.schedule;
+      schedule.group = group;
+      return setControllerSchedule(name, schedule);
+    }
+  }
+  return false;
+}
+
+bool YarrboardApp::setControllerSchedule(const char* name, const ControllerSchedule& schedule)
+{
+  if (_groupsStarted || schedule.group >= _groupCount)
+    return false;
+
+  for (ControllerEntry& entry : _controllers) {
+    if (entry.controller && entry.controller->getName() && (std::strcmp(entry.controller->getName(), name) == 0)) {
+      if (entry.hooks & YB_HOOK_BIT(YB_HOOK_LOOP)) {
+        ControllerScheduler& from = _groups[entry.schedule.group].scheduler;
+        ControllerScheduler& to = _groups[schedule.group].scheduler;
+
+        // put it back the way it was if the new one has no room
+        from.remove(entry.controller);
+        if (!to.add(entry.controller, entry.order, schedule)) {
+          from.add(entry.controller, entry.order, entry.schedule);
+          return false;
+        }
+      }
+
+      entry.schedule = schedule;
+      entry.controller->_group = schedule.group;
+      _rebuildHooks();
+      return true;
+    }
+  }
+  return false;
+}
+
+void YarrboardApp::updateBrightness(float brightness)
+{
+  config.globalBrightness = brightness;
+
+  // brightness isn't saved, so leave the config etag alone and only drop the
+  // cached get_config.  clients track it through the set_brightness broadcast.
+  protocol.invalidateCache("get_config");
+
+  for (size_t i = 0; i < _groupCount; i++)
+    _groups[i].brightnessPending = true;
+}
+
 // Register a controller instance (non-owning).
 // Returns false if full or name duplicate.
 // Controllers are sorted by order (lower values run first).
-bool YarrboardApp::registerController(BaseController& controller, uint8_t order)
+bool YarrboardApp::registerController(BaseController& controller, uint8_t order, const ControllerSchedule& schedule, uint32_t hooks)
 {
   const char* n = controller.getName();
   if (!n || !*n)
@@ -140,8 +517,21 @@ bool YarrboardApp::registerController(BaseController& controller, uint8_t order)
     return false;
   }
 
+  if (schedule.group >= _groupCount) {
+    return false;
+  }
+
+  // no loop() means nothing to schedule
+  if ((hooks & YB_HOOK_BIT(YB_HOOK_LOOP)) && !_groups[schedule.group].scheduler.add(&controller, order, schedule)) {
+    return false;
+  }
+
+  // resolve our loop timer label once, instead of a strcmp every pass
+  controller.getTiming().probe = debug.it.intern(n);
+  controller._group = schedule.group;
+
   // Create new entry
-  ControllerEntry entry(&controller, order);
+  ControllerEntry entry(&controller, order, schedule, hooks);
 
   // Find insertion point to maintain sorted order
   auto it = _controllers.begin();
@@ -151,6 +541,7 @@ bool YarrboardApp::registerController(BaseController& controller, uint8_t order)
 
   // Insert at the correct position
   _controllers.insert(it, entry);
+  _rebuildHooks();
   return true;
 }
 
@@ -182,13 +573,31 @@ bool YarrboardApp::removeController(const char* name)
   for (size_t i = 0; i < _controllers.size(); i++) {
     const ControllerEntry& entry = _controllers[i];
     if (entry.controller && entry.controller->getName() && (std::strcmp(entry.controller->getName(), name) == 0)) {
+      _groups[entry.schedule.group].scheduler.remove(entry.controller);
       _controllers.erase(_controllers.begin() + i);
+      _rebuildHooks();
       return true;
     }
   }
   return false;
 }
 
+// Precompute who implements each hook so the hot paths don't fan out
+// a virtual call to every controller.
+void YarrboardApp::_rebuildHooks()
+{
+  for (size_t hook = 0; hook < YB_HOOK_COUNT; hook++) {
+    _hookControllers[hook].clear();
+    _hookGroups[hook] = 0;
+    for (const ControllerEntry& entry : _controllers) {
+      if (entry.hooks & YB_HOOK_BIT(hook)) {
+        _hookControllers[hook].push_back(entry.controller);
+        _hookGroups[hook] |= 1 << entry.schedule.group;
+      }
+    }
+  }
+}
+
 void YarrboardApp::setStatusColor(uint8_t r, uint8_t g, uint8_t b)
 {
   RGBControllerInterface* rgb = (RGBControllerInterface*)getController("rgb");
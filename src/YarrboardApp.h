@@ -14,7 +14,9 @@
 #define YarrboardApp_h
 
 #include "ConfigManager.h"
+#include "ControllerScheduler.h"
 #include "IntervalTimer.h"
+#include "JsonPool.h"
 #include "RollingAverage.h"
 #include "YarrboardDebug.h"
 #include "controllers/AuthController.h"
@@ -29,9 +31,12 @@
 #include "controllers/ProtocolController.h"
 #include "controllers/RGBController.h"
 
+#include <atomic>
 #include <cstring>         // For strcmp
 #include <etl/algorithm.h> // For finding/removing
+#include <etl/array.h>
 #include <etl/vector.h>
+#include <type_traits>
 
 class YarrboardApp
 {
@@ -39,13 +44,24 @@ class YarrboardApp
     struct ControllerEntry {
         BaseController* controller;
         uint8_t order;
+        ControllerSchedule schedule;
+        uint32_t hooks;
+        bool pending; // waiting on YB_NEEDS_* before setup()
 
-        ControllerEntry() : controller(nullptr), order(0) {}
-        ControllerEntry(BaseController* c, uint8_t o) : controller(c), order(o) {}
+        ControllerEntry() : controller(nullptr), order(0), hooks(0), pending(false) {}
+        ControllerEntry(BaseController* c, uint8_t o, const ControllerSchedule& s, uint32_t h) : controller(c), order(o), schedule(s), hooks(h), pending(false) {}
 
         bool operator<(const ControllerEntry& other) const { return order < other.order; }
     };
 
+    // one step of startup, timestamps are esp_timer_get_time() (us since power on)
+    struct BootEvent {
+        const char* name;
+        int64_t start_us;
+        uint32_t duration_us;
+        bool ok;
+    };
+
     ConfigManager config;
     DebugController debug;
     NetworkController network;
@@ -84,6 +100,28 @@ class YarrboardApp
     bool enable_ha_integration = false;
     bool use_hostname_as_mqtt_uuid = true;
 
+    // once a pass has taken this long, deferrable controllers wait for the next one.  0 = off
+    uint32_t loop_budget_us = 0;
+
+    // sleep between passes until the next deadline or a wake(), instead of spinning.
+    // a task group with an every-pass controller (period 0) never sleeps.
+    bool enable_idle_mode = false;
+
+    // serial api port and speed.  serial_port defaults to Serial, or point it at a
+    // dedicated uart that you have already begin()'d to keep it clear of boot output
+    Stream* serial_port = nullptr;
+    uint32_t serial_baud = 115200;
+
+    // COBS + CRC framed serial api, with logs on their own channel
+    bool enable_serial_framing = false;
+
+    // record YB_TRACE_SCOPE spans from boot, served at /trace.json
+    bool enable_tracing = false;
+
+    // run http, protocol, mqtt and ota in their own task instead of loop()
+    bool use_network_task = false;
+    int network_task_core = 0;
+
     UserRole default_role = NOBODY;
     const char* default_melody = "STARTUP";
 
@@ -93,13 +131,29 @@ class YarrboardApp
     void loop();
 
     unsigned int framerate;
+    uint8_t busy_percent = 100; // main loop, see generateTaskGroupStats() for the rest
+
+    // Wake up any idle task groups so they run a pass now.
+    // Call this when work arrives from another task (queues, callbacks, etc)
+    void wake();
+    void wakeFromISR();
 
     static constexpr size_t MAX_CONTROLLERS = 16;
 
     // Register a controller instance (non-owning).
     // Returns false if full or name duplicate.
     // Controllers are sorted by order (lower values run first).
-    bool registerController(BaseController& controller, uint8_t order = 100);
+    // The schedule controls how often loop() is called (default: every pass).
+    // The hooks the controller overrides are detected from its type, so the
+    // app only calls the ones it actually implements.
+    template <typename T>
+    bool registerController(T& controller, uint8_t order = 100, const ControllerSchedule& schedule = ControllerSchedule())
+    {
+      return registerController(controller, order, schedule, ybDetectHooks<T>());
+    }
+
+    // Same as above, with an explicit mask of YB_HOOK_BIT()s.
+    bool registerController(BaseController& controller, uint8_t order, const ControllerSchedule& schedule, uint32_t hooks);
 
     // Lookup by name (nullptr if not found)
     BaseController* getController(const char* name);
@@ -112,6 +166,63 @@ class YarrboardApp
     // Remove by name (returns true if removed)
     bool removeController(const char* name);
 
+    // Controllers that implement a hook, in registration order.
+    const etl::ivector<BaseController*>& getHookControllers(YBHook hook) const { return _hookControllers[hook]; }
+
+    // Create a FreeRTOS task that runs its own controller loop pinned to `core`.
+    // Returns the group id to use in ControllerSchedule::group, or -1 if full.
+    // Groups start running on the first pass of loop() after setup.
+    int addTaskGroup(const char* name, int core, UBaseType_t priority = 1, uint32_t stack_size = YB_TASK_GROUP_STACK_SIZE);
+
+    // Move a registered controller into another task group.
+    bool setControllerGroup(const char* name, uint8_t group);
+
+    // Change how a registered controller is scheduled, built-in ones included.
+    // Like setControllerGroup(), only before the task groups start.
+    bool setControllerSchedule(const char* name, const ControllerSchedule& schedule);
+
+    // Hand off updateBrightnessHook() to every task group.  Each group calls
+    // the hook for its own controllers at the start of its next pass.
+    void updateBrightness(float brightness);
+
+    // Run fn() on the task of `group` and wait for it to finish.  The group
+    // picks it up at the start of its next pass.  It runs right here instead
+    // if we already are that group, the groups haven't started yet, or waiting
+    // could deadlock: the main loop never waits, and other groups only wait
+    // on a lower numbered group.
+    template <typename Fn>
+    void runInGroup(uint8_t group, Fn&& fn)
+    {
+      using F = typename std::remove_reference<Fn>::type;
+
+      GroupCall call;
+      call.fn = [](void* arg) { (*static_cast<F*>(arg))(); };
+      call.arg = (void*)&fn;
+      _callInGroup(group, call);
+    }
+
+    // Call fn(controller) for every controller that implements `hook`, each
+    // one on its own group's task.  One handoff per group, not per controller.
+    template <typename Fn>
+    void forEachHook(YBHook hook, Fn&& fn)
+    {
+      for (uint8_t group = 0; group < _groupCount; group++) {
+        if (!(_hookGroups[hook] & (1 << group)))
+          continue;
+
+        runInGroup(group, [&]() {
+          for (BaseController* controller : _hookControllers[hook])
+            if (controller->getGroup() == group)
+              fn(controller);
+        });
+      }
+    }
+
+    // Add a step to the boot timeline that started at start_us and ends now.
+    void recordBootEvent(const char* name, int64_t start_us, bool ok = true);
+    void generateBootTimeline(JsonVariant output);
+    void generateTaskGroupStats(JsonVariant output);
+
     ConfigManager& getConfig() { return config; }
     const ConfigManager& getConfig() const { return config; }
 
@@ -121,17 +232,64 @@ class YarrboardApp
     void playMelody(const char* melody);
 
   private:
+    struct GroupCall {
+        void (*fn)(void* arg);
+        void* arg;
+        TaskHandle_t waiter = nullptr;
+        std::atomic<bool> done{false};
+    };
+
+    struct TaskGroup {
+        YarrboardApp* app = nullptr;
+        const char* name = nullptr;
+        int core = tskNO_AFFINITY;
+        UBaseType_t priority = 1;
+        uint32_t stack_size = YB_TASK_GROUP_STACK_SIZE;
+        TaskHandle_t task = nullptr;
+        ControllerScheduler scheduler;
+
+        // latest-value mailbox for cross group hooks
+        std::atomic<bool> brightnessPending{false};
+
+        // GroupCall* from runInGroup(), run at the start of each pass
+        QueueHandle_t calls = NULL;
+
+        // time spent blocked in idle mode, for busy_percent
+        std::atomic<uint32_t> idle_us{0};
+        uint8_t busy_percent = 100;
+    };
+
     WebsocketPrint networkLogger;
 
     // various timer things.
-    RollingAverage loopSpeed;
-    RollingAverage framerateAvg;
+    RollingAverage<uint32_t, 100> loopSpeed;
+    RollingAverage<uint32_t, 10> framerateAvg;
     unsigned long lastLoopMicros = 0;
     unsigned long lastLoopMillis = 0;
 
     etl::vector<ControllerEntry, YB_MAX_CONTROLLERS> _controllers;
+    etl::vector<BootEvent, YB_MAX_CONTROLLERS + 8> _bootTimeline;
+    size_t _pendingCount = 0;
+    etl::array<etl::vector<BaseController*, YB_MAX_CONTROLLERS>, YB_HOOK_COUNT> _hookControllers;
+    etl::array<uint8_t, YB_HOOK_COUNT> _hookGroups = {}; // bit per task group with a controller on that hook
+    static_assert(YB_MAX_TASK_GROUPS <= 8, "_hookGroups has a bit per task group");
+    etl::array<TaskGroup, YB_MAX_TASK_GROUPS> _groups;
+    size_t _groupCount = 1;
+    bool _groupsStarted = false;
 
     void _handleImprov();
+    void _rebuildHooks();
+    bool _needsMet(uint8_t needs);
+    void _startController(ControllerEntry& entry);
+    void _startPending();
+    void _startTaskGroups();
+    void _runGroup(TaskGroup& group);
+    void _runGroupCalls(TaskGroup& group);
+    void _callInGroup(uint8_t group, GroupCall& call);
+    int _currentGroup();
+    bool _idleGroup(TaskGroup& group);
+    void _updateBusyPercent(uint32_t window_us);
+    static void _taskGroupLoop(void* pv);
 };
 
 #endif /* YarrboardApp_h */
\ No newline at end of file
@@ -0,0 +1,254 @@
+/*
+ * Yarrboard Framework
+ *
+ * Copyright (c) 2025 Zach Hoeken <hoeken@gmail.com>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include "YarrboardBenchmark.h"
+#include "IntervalTimer.h"
+#include "RollingAverage.h"
+#include "TopicWalker.h"
+#include "YarrboardApp.h"
+#include "channels/BaseChannel.h"
+#include "controllers/ChannelController.h"
+#include <new>
+
+// a full board's worth of channels for the lookup and config cases
+typedef ChannelController<BaseChannel, 32> BenchmarkChannels;
+
+void YarrboardBenchmark::_runInLoop(void (*fn)(void*), void* arg)
+{
+  _app.runInGroup(0, [&]() { fn(arg); });
+}
+
+void YarrboardBenchmark::run(JsonVariant output, uint32_t iterations)
+{
+  output["msg"] = "benchmark";
+  output["iterations"] = iterations;
+  output["cpu_mhz"] = getCpuFrequencyMhz();
+  output["firmware_version"] = _app.firmware_version;
+  output["git_hash"] = GIT_HASH;
+
+  JsonArray results = output["results"].to<JsonArray>();
+
+  // serialization target for the json cases
+  static char buffer[4096];
+
+  RollingAverage<> ra(RA_DEFAULT_WINDOW);
+  measure(results, "rolling_average_add", iterations, [&](uint32_t i) {
+    ra.add(i);
+  });
+
+  measure(results, "rolling_average_average", iterations, [&](uint32_t i) {
+    ra.average();
+  });
+
+  measure(results, "rolling_average_snapshot", iterations, [&](uint32_t i) {
+    ra.snapshot();
+  });
+
+  // too big for the handler's stack
+  static IntervalTimer it;
+  it.reset();
+  measure(results, "interval_timer_time", iterations, [&](uint32_t i) {
+    it.time((i & 1) ? "odd" : "even");
+  });
+
+  measure(results, "controller_lookup", iterations, [&](uint32_t i) {
+    _app.getController("mqtt");
+  });
+
+  // scratch channels that are never registered, so the cases below can't
+  // touch a real board.  too big for the worker's stack.
+  BenchmarkChannels* channels = new (std::nothrow) BenchmarkChannels(_app, "benchmark");
+  if (channels != nullptr) {
+    // worst case for a full board, the key we want is the last one
+    measure(results, "channel_lookup_id", iterations, [&](uint32_t i) {
+      channels->getChannelById(32);
+    });
+
+    measure(results, "channel_lookup_key", iterations, [&](uint32_t i) {
+      channels->getChannelByKey("32");
+    });
+  }
+
+  measure(results, "command_lookup", iterations, [&](uint32_t i) {
+    _app.protocol.hasCommand("set_brightness");
+  });
+
+  measure(results, "handle_received_json_ping", iterations, [&](uint32_t i) {
+    JsonDocument input(&_allocator);
+    JsonDocument out(&_allocator);
+    input["cmd"] = "ping";
+    ProtocolContext context;
+    _app.protocol.handleReceivedJSON(input, out, context);
+  }, true);
+
+  int16_t pingId = _app.protocol.getCommandId("ping");
+  measure(results, "handle_received_json_ping_id", iterations, [&](uint32_t i) {
+    JsonDocument input(&_allocator);
+    JsonDocument out(&_allocator);
+    input["cmd"] = pingId;
+    ProtocolContext context;
+    _app.protocol.handleReceivedJSON(input, out, context);
+  }, true);
+
+  // same again from the json pool, allocs_per_op counts pool misses
+  measure(results, "handle_received_json_ping_pooled", iterations, [&](uint32_t i) {
+    uint32_t misses = jsonPool.misses;
+    {
+      JsonDocument input(&jsonPool);
+      JsonDocument out(&jsonPool);
+      input["cmd"] = "ping";
+      ProtocolContext context;
+      _app.protocol.handleReceivedJSON(input, out, context);
+    }
+    _allocator.allocations += jsonPool.misses - misses;
+  }, true);
+
+  // every repeat should come out of the response cache
+  {
+    uint32_t hits = _app.protocol.responseCache.hits;
+    JsonObject jo = measure(results, "get_config_cached", iterations, [&](uint32_t i) {
+      JsonDocument input(&_allocator);
+      JsonDocument out(&_allocator);
+      input["cmd"] = "get_config";
+      ProtocolContext context;
+      context.role = GUEST;
+      _app.protocol.runCommand(input, out, context);
+    }, true);
+
+    hits = _app.protocol.responseCache.hits - hits;
+    jo["cache_hits"] = hits;
+    if (iterations > 1 && !hits) {
+      output["cache_ok"] = false;
+      YBP.println("❌ Benchmark: get_config never hit the response cache");
+    } else
+      output["cache_ok"] = true;
+  }
+
+  measure(results, "deserialize_command", iterations, [&](uint32_t i) {
+    JsonDocument input(&_allocator);
+    deserializeJson(input, "{\"cmd\":\"set_brightness\",\"brightness\":0.5,\"msgid\":1234}");
+  });
+
+  measure(results, "generate_update", iterations, [&](uint32_t i) {
+    JsonDocument out(&_allocator);
+    _app.forEachHook(YB_HOOK_UPDATE, [&](BaseController* controller) {
+      controller->generateUpdateHook(out);
+    });
+    serializeJson(out, buffer, sizeof(buffer));
+  }, true);
+
+  // the debug hook would reset the loop timer with reset_timer_on_read
+  measure(results, "generate_stats", iterations, [&](uint32_t i) {
+    JsonDocument out(&_allocator);
+    _app.forEachHook(YB_HOOK_STATS, [&](BaseController* controller) {
+      if (controller == &_app.debug)
+        _app.debug.generateTimerStats(out);
+      else
+        controller->generateStatsHook(out);
+    });
+    serializeJson(out, buffer, sizeof(buffer));
+  }, true);
+
+  // json vs msgpack on the wire, using the same update message
+  {
+    JsonDocument update;
+    update["msg"] = "update";
+    update["uptime"] = esp_timer_get_time();
+    _app.forEachHook(YB_HOOK_UPDATE, [&](BaseController* controller) {
+      controller->generateUpdateHook(update);
+    });
+
+    static char packed[4096];
+    size_t jsonSize = serializeJson(update, buffer, sizeof(buffer));
+    size_t packSize = serializeMsgPack(update, packed, sizeof(packed));
+
+    measure(results, "serialize_update_json", iterations, [&](uint32_t i) {
+      serializeJson(update, buffer, sizeof(buffer));
+    })["bytes"] = jsonSize;
+
+    measure(results, "serialize_update_msgpack", iterations, [&](uint32_t i) {
+      serializeMsgPack(update, packed, sizeof(packed));
+    })["bytes"] = packSize;
+
+    measure(results, "deserialize_update_json", iterations, [&](uint32_t i) {
+      JsonDocument input(&_allocator);
+      deserializeJson(input, buffer, jsonSize);
+    })["bytes"] = jsonSize;
+
+    measure(results, "deserialize_update_msgpack", iterations, [&](uint32_t i) {
+      JsonDocument input(&_allocator);
+      deserializeMsgPack(input, packed, packSize);
+    })["bytes"] = packSize;
+
+    // what mqttUpdateHook() does to each channel update, minus the network
+    uint32_t topics = 0;
+    measure(results, "mqtt_traverse_json", iterations, [&](uint32_t i) {
+      topics = 0;
+      TopicWalker::walk(update, "benchmark", [](void* context, const char* topic, const char* payload) {
+        (*static_cast<uint32_t*>(context))++;
+      }, &topics);
+    })["topics"] = topics;
+  }
+
+  // steady state delta, nothing but uptime changes between passes
+  {
+    static UpdateDelta delta;
+    uint32_t seq = 0;
+    size_t deltaSize = 0;
+    JsonObject jo = measure(results, "generate_update_delta", iterations, [&](uint32_t i) {
+      JsonDocument update(&_allocator);
+      JsonDocument out(&_allocator);
+      update["msg"] = "update";
+      update["uptime"] = esp_timer_get_time();
+      _app.forEachHook(YB_HOOK_UPDATE, [&](BaseController* controller) {
+        controller->generateUpdateHook(update);
+      });
+      delta.generate(YBP_MODE_NONE, 0, seq, update, out);
+      seq = out["seq"];
+      deltaSize = serializeJson(out, buffer, sizeof(buffer));
+    }, true);
+    jo["bytes"] = deltaSize;
+  }
+
+  // config is big, so fewer passes
+  uint32_t slow = iterations / 10 ? iterations / 10 : 1;
+  measure(results, "generate_full_config", slow, [&](uint32_t i) {
+    JsonDocument out(&_allocator);
+    _app.config.generateFullConfig(out);
+  }, true);
+
+  measure(results, "measure_full_config", slow, [&](uint32_t i) {
+    JsonDocument out(&_allocator);
+    _app.config.generateFullConfig(out);
+    measureJson(out);
+  }, true);
+
+  // load the config we already have into a scratch ConfigManager and the
+  // scratch channels.  loadConfigFromJSON() itself would rewrite _cfg and
+  // run every controller's loadConfigHook().
+  ConfigManager* scratch = new (std::nothrow) ConfigManager(_app);
+  if (channels != nullptr && scratch != nullptr) {
+    JsonDocument config;
+    _app.runInGroup(0, [&]() { _app.config.generateFullConfig(config); });
+    channels->generateConfigHook(config["board"]);
+
+    char error[YB_ERROR_LENGTH];
+    measure(results, "load_config_json", slow, [&](uint32_t i) {
+      scratch->loadNetworkConfigFromJSON(config["network"], error, sizeof(error));
+      scratch->loadAppConfigFromJSON(config["app"], error, sizeof(error));
+      channels->loadConfigHook(config["board"], error, sizeof(error));
+    });
+  }
+
+  delete scratch;
+  delete channels;
+}
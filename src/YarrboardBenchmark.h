@@ -0,0 +1,112 @@
+/*
+ * Yarrboard Framework
+ *
+ * Copyright (c) 2025 Zach Hoeken <hoeken@gmail.com>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#ifndef YARR_BENCHMARK_H
+#define YARR_BENCHMARK_H
+
+#include "YarrboardConfig.h"
+#include <ArduinoJson.h>
+#include <esp_timer.h>
+
+class YarrboardApp;
+
+// ArduinoJson allocator that counts how often it hits the heap.
+class CountingAllocator : public ArduinoJson::Allocator
+{
+  public:
+    uint32_t allocations = 0;
+
+    void* allocate(size_t size) override
+    {
+      allocations++;
+      return malloc(size);
+    }
+
+    void deallocate(void* ptr) override { free(ptr); }
+
+    void* reallocate(void* ptr, size_t new_size) override
+    {
+      allocations++;
+      return realloc(ptr, new_size);
+    }
+};
+
+/**
+ * YarrboardBenchmark
+ *
+ * Microbenchmarks for the framework's hot paths, run on the board itself so
+ * the numbers include the real allocator, flash cache and clock speed.
+ * Each case reports ns/op and ArduinoJson heap allocations/op as JSON, so
+ * results can be saved and compared across releases.
+ *
+ * run() is meant for the async worker.  Cases that touch controller state
+ * run inside the main loop's task group, YB_BENCHMARK_BATCH iterations at a
+ * time, so the scheduler keeps going in between.  Only the time inside the
+ * batches is counted.  The hardware-free parts also have a host benchmark
+ * in test/test_benchmark.
+ */
+class YarrboardBenchmark
+{
+  public:
+    YarrboardBenchmark(YarrboardApp& app) : _app(app) {}
+
+    void run(JsonVariant output, uint32_t iterations);
+
+  private:
+    YarrboardApp& _app;
+    CountingAllocator _allocator;
+
+    // YarrboardApp is only forward declared here
+    template <typename F>
+    void runInLoop(F& fn)
+    {
+      _runInLoop([](void* arg) { (*static_cast<F*>(arg))(); }, &fn);
+    }
+    void _runInLoop(void (*fn)(void*), void* arg);
+
+    template <typename F>
+    JsonObject measure(JsonArray results, const char* name, uint32_t iterations, F&& fn, bool inLoop = false)
+    {
+      _allocator.allocations = 0;
+
+      int64_t elapsed = 0;
+      for (uint32_t done = 0; done < iterations;) {
+        uint32_t batch = iterations - done;
+        if (inLoop && batch > YB_BENCHMARK_BATCH)
+          batch = YB_BENCHMARK_BATCH;
+
+        auto runBatch = [&]() {
+          int64_t start = esp_timer_get_time();
+          for (uint32_t i = done; i < done + batch; i++)
+            fn(i);
+          elapsed += esp_timer_get_time() - start;
+        };
+
+        if (inLoop)
+          runInLoop(runBatch);
+        else
+          runBatch();
+
+        done += batch;
+      }
+
+      JsonObject jo = results.add<JsonObject>();
+      jo["name"] = name;
+      jo["iterations"] = iterations;
+      jo["ns_per_op"] = (uint32_t)(elapsed * 1000 / iterations);
+      jo["allocs_per_op"] = (float)_allocator.allocations / iterations;
+
+      return jo;
+    }
+};
+
+#endif /* !YARR_BENCHMARK_H */
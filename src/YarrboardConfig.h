@@ -11,7 +11,7 @@
  */
 
 #include "YarrboardVersion.h"
-#include <Arduino.h>
+#include "YarrboardHAL.h"
 
 #ifndef YB_FRAMEWORK_CONFIG_H
   #define YB_FRAMEWORK_CONFIG_H
@@ -54,6 +54,31 @@
   // for handling messages outside of the loop
   #define YB_RECEIVE_BUFFER_COUNT 100
 
+  // websocket messages per second each role gets, with this much burst. 0 = unlimited
+  #ifndef YB_WS_RATE_NOBODY
+    #define YB_WS_RATE_NOBODY 5
+  #endif
+  #ifndef YB_WS_BURST_NOBODY
+    #define YB_WS_BURST_NOBODY 10
+  #endif
+  #ifndef YB_WS_RATE_GUEST
+    #define YB_WS_RATE_GUEST 20
+  #endif
+  #ifndef YB_WS_BURST_GUEST
+    #define YB_WS_BURST_GUEST 40
+  #endif
+  #ifndef YB_WS_RATE_ADMIN
+    #define YB_WS_RATE_ADMIN 50
+  #endif
+  #ifndef YB_WS_BURST_ADMIN
+    #define YB_WS_BURST_ADMIN 100
+  #endif
+
+  // each client gets an equal share of the receive queue, but never less than this
+  #ifndef YB_WS_MIN_QUEUE_SHARE
+    #define YB_WS_MIN_QUEUE_SHARE 4
+  #endif
+
   // various string lengths
   #define YB_PREF_KEY_LENGTH      16
   #define YB_BOARD_NAME_LENGTH    32
@@ -104,8 +129,155 @@
     #define YB_MAX_CONTROLLERS 30
   #endif
 
+  // main loop + extra controller tasks
+  #ifndef YB_MAX_TASK_GROUPS
+    #define YB_MAX_TASK_GROUPS 4
+  #endif
+
+  #ifndef YB_TASK_GROUP_STACK_SIZE
+    #define YB_TASK_GROUP_STACK_SIZE 8192
+  #endif
+
+  // hook and command calls that can be waiting on one task group at once
+  #ifndef YB_GROUP_CALL_QUEUE_SIZE
+    #define YB_GROUP_CALL_QUEUE_SIZE 8
+  #endif
+
+  #ifndef YB_WIFI_CONNECT_TIMEOUT_MS
+    #define YB_WIFI_CONNECT_TIMEOUT_MS 15000
+  #endif
+
+  // longest an idle task group sleeps before polling its controllers again
+  #ifndef YB_IDLE_MAX_WAIT_MS
+    #define YB_IDLE_MAX_WAIT_MS 10
+  #endif
+
+  // IntervalTimer labels and log2 histogram buckets (the last one is 2^22us+)
+  #ifndef YB_INTERVAL_TIMER_MAX_LABELS
+    #define YB_INTERVAL_TIMER_MAX_LABELS 32
+  #endif
+
+  #ifndef YB_INTERVAL_TIMER_BUCKETS
+    #define YB_INTERVAL_TIMER_BUCKETS 24
+  #endif
+
+  // trace events per core (power of 2) and distinct task names we remember
+  #ifndef YB_TRACE_BUFFER_SIZE
+    #define YB_TRACE_BUFFER_SIZE 256
+  #endif
+
+  #ifndef YB_TRACE_MAX_TASKS
+    #define YB_TRACE_MAX_TASKS 16
+  #endif
+
+  // a deferrable controller always runs after this many skipped passes
+  #ifndef YB_MAX_DEFERRALS
+    #define YB_MAX_DEFERRALS 10
+  #endif
+
+  // benchmark iterations that run in the main loop between passes
+  #ifndef YB_BENCHMARK_BATCH
+    #define YB_BENCHMARK_BATCH 100
+  #endif
+
+  // how many controllers get_stats lists in loop_budget.worst
+  #ifndef YB_BUDGET_REPORT_COUNT
+    #define YB_BUDGET_REPORT_COUNT 5
+  #endif
+
   #ifndef YB_PROTOCOL_MAX_COMMANDS
     #define YB_PROTOCOL_MAX_COMMANDS 50
   #endif
 
+  #ifndef YB_PROTOCOL_MAX_BATCH
+    #define YB_PROTOCOL_MAX_BATCH 32
+  #endif
+
+  // async commands that can be waiting on a reply at once
+  #ifndef YB_PROTOCOL_MAX_PENDING
+    #define YB_PROTOCOL_MAX_PENDING 4
+  #endif
+
+  // give up on an async command and answer with an error after this long
+  #ifndef YB_PROTOCOL_ASYNC_TIMEOUT_MS
+    #define YB_PROTOCOL_ASYNC_TIMEOUT_MS 45000
+  #endif
+
+  // worker task for async commands, started the first time one needs it
+  #ifndef YB_PROTOCOL_WORKER_STACK_SIZE
+    #define YB_PROTOCOL_WORKER_STACK_SIZE 8192
+  #endif
+
+  #ifndef YB_PROTOCOL_WORKER_PRIORITY
+    #define YB_PROTOCOL_WORKER_PRIORITY 1
+  #endif
+
+  // set_mqtt_config waits this long for the broker before answering with an error
+  #ifndef YB_MQTT_CONNECT_TIMEOUT_MS
+    #define YB_MQTT_CONNECT_TIMEOUT_MS 5000
+  #endif
+
+  // distinct (topic, rate) feeds for the subscribe command
+  #ifndef YB_MAX_SUBSCRIPTIONS
+    #define YB_MAX_SUBSCRIPTIONS 16
+  #endif
+
+  #ifndef YB_SUBSCRIBE_MIN_RATE_MS
+    #define YB_SUBSCRIBE_MIN_RATE_MS 100
+  #endif
+
+  // cached responses for read-only commands, see ProtocolController::cacheCommand()
+  #ifndef YB_RESPONSE_CACHE_SIZE
+    #define YB_RESPONSE_CACHE_SIZE 8
+  #endif
+
+  // config is invalidated on save, the ttl just catches things like the boot log
+  #ifndef YB_RESPONSE_CACHE_CONFIG_TTL_MS
+    #define YB_RESPONSE_CACHE_CONFIG_TTL_MS 5000
+  #endif
+
+  #ifndef YB_RESPONSE_CACHE_UPDATE_TTL_MS
+    #define YB_RESPONSE_CACHE_UPDATE_TTL_MS 100
+  #endif
+
+  // clients tracked for delta updates, each one costs YB_DELTA_MAX_FIELDS * 4 bytes
+  #ifndef YB_DELTA_MAX_CLIENTS
+    #define YB_DELTA_MAX_CLIENTS 8
+  #endif
+
+  // bigger updates than this always go out in full
+  #ifndef YB_DELTA_MAX_FIELDS
+    #define YB_DELTA_MAX_FIELDS 512
+  #endif
+
+  // longest line the serial api accepts, longer ones are thrown away
+  #ifndef YB_SERIAL_RX_BUFFER_SIZE
+    #define YB_SERIAL_RX_BUFFER_SIZE 4096
+  #endif
+
+  // most bytes read from the serial port on one pass of the loop
+  #ifndef YB_SERIAL_RX_BUDGET
+    #define YB_SERIAL_RX_BUDGET 1024
+  #endif
+
+  // outgoing serial messages wait here, the oldest ones get dropped when it fills up
+  #ifndef YB_SERIAL_TX_BUFFER_SIZE
+    #define YB_SERIAL_TX_BUFFER_SIZE 8192
+  #endif
+
+  // longest log line sent on the framed serial log channel
+  #ifndef YB_SERIAL_LOG_LINE_LENGTH
+    #define YB_SERIAL_LOG_LINE_LENGTH 256
+  #endif
+
+  // multiplier for the JsonPool slabs, 1 = ~40 KB.  0 sends everything to the heap
+  #ifndef YB_JSON_POOL_SCALE
+    #define YB_JSON_POOL_SCALE 1
+  #endif
+
+  // replies are serialized into chunks this big, each one a websocket frame or http chunk
+  #ifndef YB_STREAM_CHUNK_SIZE
+    #define YB_STREAM_CHUNK_SIZE 1024
+  #endif
+
 #endif // YARR_CONFIG_H
\ No newline at end of file
@@ -0,0 +1,155 @@
+/*
+ * Yarrboard Framework
+ *
+ * Copyright (c) 2025 Zach Hoeken <hoeken@gmail.com>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#ifndef YARR_HAL_H
+#define YARR_HAL_H
+
+/**
+ * The small slice of the hardware that the pure parts of the framework
+ * (scheduler, RollingAverage, IntervalTimer, UpdateDelta, ChunkedPrint,
+ * FrameCodec, config defines) depend on.
+ *
+ * On the board these are just millis() / micros() and the Arduino Print.
+ * Building with -D YB_NATIVE swaps in a clock you drive by hand, a
+ * std::mutex and a bare bones Print, so those pieces compile and run on a host without
+ * Arduino.h (see [env:native] and test/):
+ *
+ *   YarrboardClock::set_us(0);
+ *   ra.add(10);
+ *   YarrboardClock::advance_ms(1500);
+ *   ra.average();   // sample has aged out
+ */
+
+#include <stdint.h>
+
+#ifdef YB_NATIVE
+
+  #include <cstddef>
+
+struct YarrboardClock {
+    static inline uint64_t now_us = 0;
+
+    static void set_us(uint64_t us) { now_us = us; }
+    static void advance_us(uint64_t us) { now_us += us; }
+    static void advance_ms(uint64_t ms) { now_us += ms * 1000; }
+};
+
+inline uint32_t yb_millis() { return (uint32_t)(YarrboardClock::now_us / 1000); }
+inline uint32_t yb_micros() { return (uint32_t)YarrboardClock::now_us; }
+
+  #ifndef IRAM_ATTR
+    #define IRAM_ATTR
+  #endif
+
+  #include <cstdarg>
+  #include <cstdio>
+  #include <cstring>
+  #include <mutex>
+
+class YarrboardMutex
+{
+  public:
+    void lock() { _mutex.lock(); }
+    void unlock() { _mutex.unlock(); }
+
+  private:
+    std::mutex _mutex;
+};
+
+// just enough of Arduino's Print for our own classes
+class Print
+{
+  public:
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t b) = 0;
+    virtual size_t write(const uint8_t* data, size_t len)
+    {
+      size_t n = 0;
+      while (len--)
+        n += write(*data++);
+      return n;
+    }
+
+    size_t write(const char* str) { return write((const uint8_t*)str, strlen(str)); }
+    size_t print(const char* str) { return write(str); }
+    size_t println(const char* str) { return print(str) + println(); }
+    size_t println() { return write("\r\n"); }
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)))
+    {
+      char buf[256];
+      va_list args;
+      va_start(args, format);
+      int len = vsnprintf(buf, sizeof(buf), format, args);
+      va_end(args);
+      if (len < 0)
+        return 0;
+      return write((const uint8_t*)buf, (size_t)len < sizeof(buf) ? len : sizeof(buf) - 1);
+    }
+};
+
+// stands in for Serial
+class YarrboardStdoutPrint : public Print
+{
+  public:
+    size_t write(uint8_t b) override { return fputc(b, stdout) == EOF ? 0 : 1; }
+    using Print::write;
+};
+
+inline Print& yb_default_print()
+{
+  static YarrboardStdoutPrint out;
+  return out;
+}
+
+#else
+
+  #include <Arduino.h>
+
+inline uint32_t yb_millis() { return millis(); }
+inline uint32_t yb_micros() { return micros(); }
+
+// where debug output goes unless you say otherwise
+inline Print& yb_default_print() { return Serial; }
+
+// blocking mutex for state shared between tasks, e.g. httpd and the protocol task
+class YarrboardMutex
+{
+  public:
+    YarrboardMutex() { _mutex = xSemaphoreCreateMutex(); }
+    ~YarrboardMutex() { vSemaphoreDelete(_mutex); }
+
+    void lock() { xSemaphoreTake(_mutex, portMAX_DELAY); }
+    void unlock() { xSemaphoreGive(_mutex); }
+
+  private:
+    SemaphoreHandle_t _mutex;
+};
+
+#endif
+
+// holds a YarrboardMutex for the rest of the scope
+class YarrboardLock
+{
+  public:
+    explicit YarrboardLock(YarrboardMutex& mutex) : _mutex(mutex) { _mutex.lock(); }
+    ~YarrboardLock() { _mutex.unlock(); }
+
+    YarrboardLock(const YarrboardLock&) = delete;
+    YarrboardLock& operator=(const YarrboardLock&) = delete;
+
+  private:
+    YarrboardMutex& _mutex;
+};
+
+#endif /* !YARR_HAL_H */
@@ -0,0 +1,157 @@
+/*
+ * Yarrboard Framework
+ *
+ * Copyright (c) 2025 Zach Hoeken <hoeken@gmail.com>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include "YarrboardTrace.h"
+
+volatile bool YarrboardTrace::_enabled = false;
+YarrboardTrace::Ring YarrboardTrace::_rings[portNUM_PROCESSORS];
+YarrboardTrace::TaskName YarrboardTrace::_tasks[YB_TRACE_MAX_TASKS];
+std::atomic<uint32_t> YarrboardTrace::_taskCount{0};
+portMUX_TYPE YarrboardTrace::_taskLock = portMUX_INITIALIZER_UNLOCKED;
+
+static_assert((YB_TRACE_BUFFER_SIZE & (YB_TRACE_BUFFER_SIZE - 1)) == 0, "YB_TRACE_BUFFER_SIZE must be a power of 2");
+
+bool YarrboardTrace::setEnabled(bool enabled)
+{
+#ifdef YB_DISABLE_TRACE
+  // nothing records anything, so don't pretend
+  if (enabled)
+    return false;
+#endif
+
+  // allocate once, on first use, and keep it
+  if (enabled) {
+    for (Ring& ring : _rings) {
+      if (ring.events)
+        continue;
+
+      ring.events = new (std::nothrow) Event[YB_TRACE_BUFFER_SIZE];
+      if (!ring.events)
+        return false;
+
+      for (size_t i = 0; i < YB_TRACE_BUFFER_SIZE; i++)
+        ring.events[i].seq = 0;
+    }
+  }
+
+  _enabled = enabled;
+  return true;
+}
+
+void YarrboardTrace::record(const char* name, int64_t start_us, int64_t end_us)
+{
+  if (!_enabled)
+    return;
+
+  Ring& ring = _rings[xPortGetCoreID()];
+  if (!ring.events)
+    return;
+
+  TaskHandle_t task = xTaskGetCurrentTaskHandle();
+  rememberTask(task);
+
+  uint32_t idx = ring.head.fetch_add(1, std::memory_order_relaxed);
+  Event& e = ring.events[idx & (YB_TRACE_BUFFER_SIZE - 1)];
+
+  // mark the slot busy while we fill it in
+  e.seq.store(0, std::memory_order_relaxed);
+  e.name = name;
+  e.start_us = start_us;
+  e.dur_us = (uint32_t)(end_us - start_us);
+  e.task = task;
+  e.seq.store(idx + 1, std::memory_order_release);
+}
+
+void YarrboardTrace::clear()
+{
+  for (Ring& ring : _rings) {
+    if (!ring.events)
+      continue;
+
+    for (size_t i = 0; i < YB_TRACE_BUFFER_SIZE; i++)
+      ring.events[i].seq = 0;
+  }
+}
+
+void YarrboardTrace::rememberTask(TaskHandle_t task)
+{
+  uint32_t count = _taskCount.load(std::memory_order_acquire);
+  for (uint32_t i = 0; i < count; i++) {
+    if (_tasks[i].task == task)
+      return;
+  }
+
+  if (count >= YB_TRACE_MAX_TASKS)
+    return;
+
+  // new task, this only happens a handful of times per boot
+  portENTER_CRITICAL_SAFE(&_taskLock);
+  count = _taskCount.load(std::memory_order_relaxed);
+  bool found = false;
+  for (uint32_t i = 0; i < count; i++)
+    found |= (_tasks[i].task == task);
+
+  if (!found && count < YB_TRACE_MAX_TASKS) {
+    _tasks[count].task = task;
+    strlcpy(_tasks[count].name, pcTaskGetName(task), sizeof(_tasks[count].name));
+    _taskCount.store(count + 1, std::memory_order_release);
+  }
+  portEXIT_CRITICAL_SAFE(&_taskLock);
+}
+
+void YarrboardTrace::writeJSON(Print& out)
+{
+  out.print("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+  // thread names, repeated for each core since tasks can float
+  bool first = true;
+  uint32_t taskCount = _taskCount.load(std::memory_order_acquire);
+  for (int core = 0; core < portNUM_PROCESSORS; core++) {
+    out.printf("%s{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"core %d\"}}", first ? "" : ",", core, core);
+    first = false;
+
+    for (uint32_t i = 0; i < taskCount; i++)
+      out.printf(",{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%lu,\"args\":{\"name\":\"%s\"}}", core, (unsigned long)(uintptr_t)_tasks[i].task, _tasks[i].name);
+  }
+
+  for (int core = 0; core < portNUM_PROCESSORS; core++) {
+    Ring& ring = _rings[core];
+    if (!ring.events)
+      continue;
+
+    // oldest to newest, skipping slots that are empty or mid-write
+    uint32_t head = ring.head.load(std::memory_order_acquire);
+    uint32_t start = head > YB_TRACE_BUFFER_SIZE ? head - YB_TRACE_BUFFER_SIZE : 0;
+    for (uint32_t idx = start; idx < head; idx++) {
+      const Event& e = ring.events[idx & (YB_TRACE_BUFFER_SIZE - 1)];
+      if (e.seq.load(std::memory_order_acquire) != idx + 1)
+        continue;
+
+      // copy it out, then make sure nobody lapped us while we did
+      const char* name = e.name;
+      int64_t start_us = e.start_us;
+      uint32_t dur_us = e.dur_us;
+      TaskHandle_t task = e.task;
+      if (e.seq.load(std::memory_order_acquire) != idx + 1)
+        continue;
+
+      out.printf(",{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lu,\"pid\":%d,\"tid\":%lu}",
+        name ? name : "?",
+        (long long)start_us,
+        (unsigned long)dur_us,
+        core,
+        (unsigned long)(uintptr_t)task);
+    }
+  }
+
+  out.print("]}");
+}
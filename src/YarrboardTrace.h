@@ -0,0 +1,107 @@
+/*
+ * Yarrboard Framework
+ *
+ * Copyright (c) 2025 Zach Hoeken <hoeken@gmail.com>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#ifndef YARR_TRACE_H
+#define YARR_TRACE_H
+
+#include "YarrboardConfig.h"
+#include <Arduino.h>
+#include <atomic>
+#include <esp_timer.h>
+
+/**
+ * YarrboardTrace
+ *
+ * Timeline tracing for "what was running when the loop hiccuped".
+ *
+ * YB_TRACE_SCOPE("name") times the enclosing block and, when tracing is
+ * enabled, writes one complete event (start, duration, task, core) into a
+ * ring buffer for the current core.  Writers claim slots with an atomic
+ * increment, so recording never takes a lock.  Old events are overwritten.
+ *
+ * writeJSON() dumps the buffers in Chrome trace-event format, which loads
+ * straight into chrome://tracing or https://ui.perfetto.dev.  Each core
+ * shows up as a process and each FreeRTOS task as a thread.
+ *
+ * Names must be stable C-strings (literals, controller names, etc).
+ * Tracing is off until setEnabled(true), and the buffers are only
+ * allocated then.  Build with -D YB_DISABLE_TRACE to compile it all out.
+ */
+class YarrboardTrace
+{
+  public:
+    static bool setEnabled(bool enabled);
+    static bool isEnabled() { return _enabled; }
+
+    // record a span that has already finished
+    static void record(const char* name, int64_t start_us, int64_t end_us);
+
+    static void clear();
+    static void writeJSON(Print& out);
+
+  private:
+    struct Event {
+        const char* name;
+        int64_t start_us;
+        uint32_t dur_us;
+        TaskHandle_t task;
+        std::atomic<uint32_t> seq; // slot index + 1 once the event is complete
+    };
+
+    struct Ring {
+        Event* events = nullptr;
+        std::atomic<uint32_t> head{0};
+    };
+
+    struct TaskName {
+        TaskHandle_t task;
+        char name[configMAX_TASK_NAME_LEN];
+    };
+
+    static volatile bool _enabled;
+    static Ring _rings[portNUM_PROCESSORS];
+
+    // names are copied when we first see a task, in case it gets deleted
+    static TaskName _tasks[YB_TRACE_MAX_TASKS];
+    static std::atomic<uint32_t> _taskCount;
+    static portMUX_TYPE _taskLock;
+
+    static void rememberTask(TaskHandle_t task);
+};
+
+class YarrboardTraceScope
+{
+  public:
+    YarrboardTraceScope(const char* name) : _name(name), _start(YarrboardTrace::isEnabled() ? esp_timer_get_time() : 0) {}
+    ~YarrboardTraceScope()
+    {
+      if (_start)
+        YarrboardTrace::record(_name, _start, esp_timer_get_time());
+    }
+
+  private:
+    const char* _name;
+    int64_t _start;
+};
+
+// YB_TRACE_RECORD is for spans that start somewhere else, like a queue wait
+#ifdef YB_DISABLE_TRACE
+  #define YB_TRACE_SCOPE(name)                    ((void)0)
+  #define YB_TRACE_RECORD(name, start_us, end_us) ((void)0)
+#else
+  #define YB_TRACE_CAT2(a, b)                     a##b
+  #define YB_TRACE_CAT(a, b)                      YB_TRACE_CAT2(a, b)
+  #define YB_TRACE_SCOPE(name)                    YarrboardTraceScope YB_TRACE_CAT(_yb_trace_, __LINE__)(name)
+  #define YB_TRACE_RECORD(name, start_us, end_us) YarrboardTrace::record(name, start_us, end_us)
+#endif
+
+#endif /* !YARR_TRACE_H */
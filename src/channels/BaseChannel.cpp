@@ -11,6 +11,7 @@
  */
 
 #include "channels/BaseChannel.h"
+#include "JsonPool.h"
 #include "YarrboardDebug.h"
 #include "controllers/MQTTController.h"
 
@@ -26,6 +27,20 @@ void BaseChannel::setup()
 {
 }
 
+void BaseChannel::requestFastUpdate()
+{
+  sendFastUpdate = true;
+  if (controller)
+    controller->signal();
+}
+
+void IRAM_ATTR BaseChannel::requestFastUpdateFromISR()
+{
+  sendFastUpdate = true;
+  if (controller)
+    controller->signalFromISR();
+}
+
 void BaseChannel::setName(const char* name)
 {
   strncpy(this->name, name, sizeof(this->name));
@@ -112,7 +127,7 @@ void BaseChannel::generateStats(JsonVariant config)
 
 void BaseChannel::mqttUpdate(MQTTController* mqtt)
 {
-  JsonDocument output;
+  JsonDocument output(&jsonPool);
   this->generateUpdate(output);
 
   char topic[128];
@@ -28,9 +28,15 @@ class BaseChannel
     char name[YB_CHANNEL_NAME_LENGTH];
     char key[YB_CHANNEL_KEY_LENGTH];
     volatile bool sendFastUpdate = false;
+    BaseController* controller = nullptr; // set by ChannelController
 
     void setup();
 
+    // flag this channel for a fast update and wake the app if it is idle.
+    // use the FromISR version in your interrupt handlers.
+    void requestFastUpdate();
+    void requestFastUpdateFromISR();
+
     void setName(const char* name);
     void setKey(const char* key);
 
@@ -177,6 +177,61 @@ void AuthController::removeClientFromAuthList(int socket)
   }
 }
 
+bool AuthController::setClientEncoding(int socket, ClientEncoding encoding)
+{
+  bool ok = true;
+
+  taskENTER_CRITICAL(&encodingLock);
+
+  auto it = clientEncodings.begin();
+  for (; it != clientEncodings.end(); ++it)
+    if (it->socket == socket)
+      break;
+
+  if (it != clientEncodings.end()) {
+    if (encoding == YB_ENCODING_JSON)
+      clientEncodings.erase(it);
+    else
+      it->encoding = encoding;
+  }
+  // json is the default
+  else if (encoding != YB_ENCODING_JSON) {
+    if (clientEncodings.full())
+      ok = false;
+    else
+      clientEncodings.push_back({socket, encoding});
+  }
+
+  taskEXIT_CRITICAL(&encodingLock);
+
+  return ok;
+}
+
+ClientEncoding AuthController::getClientEncoding(int socket)
+{
+  ClientEncoding encoding = YB_ENCODING_JSON;
+
+  taskENTER_CRITICAL(&encodingLock);
+  for (auto& entry : clientEncodings) {
+    if (entry.socket == socket) {
+      encoding = entry.encoding;
+      break;
+    }
+  }
+  taskEXIT_CRITICAL(&encodingLock);
+
+  return encoding;
+}
+
+bool AuthController::hasMsgPackClients()
+{
+  taskENTER_CRITICAL(&encodingLock);
+  bool any = !clientEncodings.empty();
+  taskEXIT_CRITICAL(&encodingLock);
+
+  return any;
+}
+
 bool AuthController::isSerialAuthenticated()
 {
   return is_serial_authenticated;
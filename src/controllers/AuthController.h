@@ -34,6 +34,17 @@ typedef struct {
     UserRole role;
 } AuthenticatedClient;
 
+// wire format a websocket client asked for in hello
+typedef enum {
+  YB_ENCODING_JSON,
+  YB_ENCODING_MSGPACK
+} ClientEncoding;
+
+typedef struct {
+    int socket;
+    ClientEncoding encoding;
+} ClientEncodingEntry;
+
 class AuthController : public BaseController
 {
   public:
@@ -56,7 +67,16 @@ class AuthController : public BaseController
     void removeClientFromAuthList(int socket);
     bool isApiClientLoggedIn(JsonVariantConst doc);
 
+    bool setClientEncoding(int socket, ClientEncoding encoding);
+    ClientEncoding getClientEncoding(int socket);
+    bool hasMsgPackClients();
+
   private:
+    // json clients aren't stored, so this only holds the msgpack ones.
+    // written by the protocol task (hello) and httpd (close), read by every send
+    etl::vector<ClientEncodingEntry, YB_CLIENT_LIMIT> clientEncodings;
+    portMUX_TYPE encodingLock = portMUX_INITIALIZER_UNLOCKED;
+
     bool is_serial_authenticated = false;
 
     bool addClientToAuthList(int socket, UserRole role);
@@ -21,6 +21,18 @@ BaseController::BaseController(YarrboardApp& app, const char* name) : _app(app),
 {
 }
 
+void BaseController::signal()
+{
+  _signalled = true;
+  _app.wake();
+}
+
+void IRAM_ATTR BaseController::signalFromISR()
+{
+  _signalled = true;
+  _app.wakeFromISR();
+}
+
 bool BaseController::start()
 {
   _started = this->setup();
@@ -14,25 +14,87 @@
 #define YARR_BASE_CONTROLLER_H
 
 #include "YarrboardConfig.h"
-#include <Arduino.h>
+#include "YarrboardHAL.h"
 #include <ArduinoJson.h>
+#include <type_traits>
 
 class YarrboardApp;
 class ConfigManager;
 class MQTTController;
 
+// hooks that YarrboardApp keeps a dispatch list for
+typedef enum {
+  YB_HOOK_LOOP,
+  YB_HOOK_LOAD_CONFIG,
+  YB_HOOK_CONFIG,
+  YB_HOOK_CAPABILITIES,
+  YB_HOOK_UPDATE,
+  YB_HOOK_FAST_UPDATE,
+  YB_HOOK_STATS,
+  YB_HOOK_MQTT_UPDATE,
+  YB_HOOK_HA_UPDATE,
+  YB_HOOK_HA_DISCOVERY,
+  YB_HOOK_BRIGHTNESS,
+  YB_HOOK_COUNT
+} YBHook;
+
+#define YB_HOOK_BIT(hook) (1UL << (hook))
+#define YB_HOOKS_ALL      (YB_HOOK_BIT(YB_HOOK_COUNT) - 1)
+
+// what a controller needs before the app calls its setup()
+#define YB_NEEDS_CONFIG (1 << 0) // config has been loaded
+#define YB_NEEDS_WIFI   (1 << 1) // wifi client has an IP address
+
+// loop() timing, filled in by the app scheduler
+struct ControllerTiming {
+    uint32_t budget_us = 0;    // 0 = no budget
+    bool deferrable = false;   // can be pushed to a later pass when the frame is over budget
+    uint32_t last_us = 0;
+    uint32_t worst_us = 0;
+    uint32_t overruns = 0;     // runs that took longer than budget_us
+    uint32_t deferred = 0;     // passes skipped because the frame was over budget
+    uint8_t deferStreak = 0;
+    int16_t probe = -1;        // interned IntervalTimer id for the main loop
+};
+
 class BaseController
 {
   public:
     BaseController(YarrboardApp& app, const char* name);
 
     bool start();
+
+    // setup() has succeeded, the app doesn't call loop() until then
     bool isStarted() { return _started; }
+    uint8_t getNeeds() { return _needs; }
 
     virtual bool setup() { return true; }
     virtual void loop() {}
     const char* getName() { return _name; }
 
+    // Ask the app to run our loop() on the next pass (wake_on_event controllers only).
+    // Also wakes the app if it is idle.  Use signalFromISR() from interrupts.
+    void signal();
+    void signalFromISR();
+    bool isSignalled() { return _signalled; }
+    bool takeSignal()
+    {
+      if (!_signalled)
+        return false;
+      _signalled = false;
+      return true;
+    }
+
+    ControllerTiming& getTiming() { return _timing; }
+    const ControllerTiming& getTiming() const { return _timing; }
+
+    // task group this controller runs in, 0 = Arduino loop()
+    uint8_t getGroup() const { return _group; }
+
+    // With task groups, every hook and every command registered with a member
+    // function of ours is called from our own task group, so they can touch
+    // the same state as loop() without locks.  needsFastUpdate() is the one
+    // exception, it is polled from the protocol task and should only read a flag.
     virtual bool loadConfigHook(JsonVariant config, char* error, size_t len) { return true; };
     virtual void generateConfigHook(JsonVariant config) {};
     virtual void generateCapabilitiesHook(JsonVariant config) {};
@@ -50,6 +112,39 @@ class BaseController
     ConfigManager& _cfg;
     const char* _name;
     bool _started = false;
+    uint8_t _needs = 0; // YB_NEEDS_* flags, set in the constructor
+    volatile bool _signalled = false;
+    ControllerTiming _timing;
+
+  private:
+    friend class YarrboardApp;
+    uint8_t _group = 0; // set by YarrboardApp
 };
 
+// true if T (or a parent between T and BaseController) overrides `method`
+#define YB_OVERRIDES(T, method) (!std::is_same<decltype(&T::method), decltype(&BaseController::method)>::value)
+
+// Figure out which hooks a controller type actually implements.
+// Registering through a plain BaseController& can't be inspected, so it gets everything.
+template <typename T>
+constexpr uint32_t ybDetectHooks()
+{
+  static_assert(std::is_base_of<BaseController, T>::value, "T must derive from BaseController");
+
+  if (std::is_same<T, BaseController>::value)
+    return YB_HOOKS_ALL;
+
+  return (YB_OVERRIDES(T, loop) ? YB_HOOK_BIT(YB_HOOK_LOOP) : 0) |
+         (YB_OVERRIDES(T, loadConfigHook) ? YB_HOOK_BIT(YB_HOOK_LOAD_CONFIG) : 0) |
+         (YB_OVERRIDES(T, generateConfigHook) ? YB_HOOK_BIT(YB_HOOK_CONFIG) : 0) |
+         (YB_OVERRIDES(T, generateCapabilitiesHook) ? YB_HOOK_BIT(YB_HOOK_CAPABILITIES) : 0) |
+         (YB_OVERRIDES(T, generateUpdateHook) ? YB_HOOK_BIT(YB_HOOK_UPDATE) : 0) |
+         (YB_OVERRIDES(T, needsFastUpdate) || YB_OVERRIDES(T, generateFastUpdateHook) ? YB_HOOK_BIT(YB_HOOK_FAST_UPDATE) : 0) |
+         (YB_OVERRIDES(T, generateStatsHook) ? YB_HOOK_BIT(YB_HOOK_STATS) : 0) |
+         (YB_OVERRIDES(T, mqttUpdateHook) ? YB_HOOK_BIT(YB_HOOK_MQTT_UPDATE) : 0) |
+         (YB_OVERRIDES(T, haUpdateHook) ? YB_HOOK_BIT(YB_HOOK_HA_UPDATE) : 0) |
+         (YB_OVERRIDES(T, haGenerateDiscoveryHook) ? YB_HOOK_BIT(YB_HOOK_HA_DISCOVERY) : 0) |
+         (YB_OVERRIDES(T, updateBrightnessHook) ? YB_HOOK_BIT(YB_HOOK_BRIGHTNESS) : 0);
+}
+
 #endif
\ No newline at end of file
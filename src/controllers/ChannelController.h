@@ -32,6 +32,7 @@ class ChannelController : public BaseController
       byte i = 0;
       for (auto& ch : _channels) {
         ch.init(i + 1);
+        ch.controller = this;
         i++;
       }
     }
@@ -135,7 +136,7 @@ class ChannelController : public BaseController
       }
     }
 
-    bool needsFastUpdate()
+    bool needsFastUpdate() override
     {
       for (auto& ch : _channels) {
         if (ch.sendFastUpdate)
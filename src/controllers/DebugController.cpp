@@ -13,13 +13,19 @@
 #include "DebugController.h"
 #include "ConfigManager.h"
 #include "YarrboardApp.h"
+#include "YarrboardBenchmark.h"
 #include "YarrboardDebug.h"
+#include "YarrboardTrace.h"
 
+#include <algorithm>
 #include <esp_core_dump.h>
 #include <esp_log.h>
 #include <esp_partition.h>
 #include <esp_system.h>
 
+// for the usb serial rx callback, which has no room for a context pointer
+static BaseController* _wakeProtocol = nullptr;
+
 static void heartbeatTask(void* pv)
 {
   while (1) {
@@ -57,10 +63,40 @@ bool DebugController::setup()
   // ONLY UNCOMMENT THIS IF YOU NEED TO TEST COREDUMP STUFF
   // registerCommand(ADMIN, "crashme", this, &DebugController::handleCrashMe);
 
+  _app.protocol.registerAsyncCommand(ADMIN, "benchmark", this, &DebugController::handleBenchmark);
+  _app.protocol.registerCommand(ADMIN, "set_tracing", this, &DebugController::handleSetTracing);
+
+  if (_app.enable_tracing && !YarrboardTrace::setEnabled(true))
+    YBP.println("ERROR: Unable to allocate trace buffers");
+
   // startup our serial
-  Serial.begin(115200);
+  Serial.begin(_app.serial_baud);
   Serial.setTimeout(50);
-  YBP.addPrinter(Serial);
+
+  // the serial api, started here so logs can use it from the beginning
+  Stream& serialPort = _app.serial_port ? *_app.serial_port : Serial;
+  if (!_app.protocol.serial.begin(serialPort, _app.enable_serial_framing))
+    return false;
+
+  // logs sharing the port go through the transport too, as whole lines (or
+  // log channel frames), so they can't splice into a half written message
+  if (_app.enable_serial_framing || &serialPort == &Serial)
+    YBP.addPrinter(_app.protocol.serial);
+  if (&serialPort != &Serial)
+    YBP.addPrinter(Serial);
+
+  // serial commands should wake us up in idle mode
+#if !ARDUINO_USB_CDC_ON_BOOT
+  Serial.onReceive([this]() { _app.protocol.signal(); });
+#else
+  // the usb cdc event handler only gets the port as its argument
+  _wakeProtocol = &_app.protocol;
+  #if ARDUINO_USB_MODE
+  Serial.onEvent(ARDUINO_HW_CDC_RX_EVENT, [](void*, esp_event_base_t, int32_t, void*) { _wakeProtocol->signal(); });
+  #else
+  Serial.onEvent(ARDUINO_USB_CDC_RX_EVENT, [](void*, esp_event_base_t, int32_t, void*) { _wakeProtocol->signal(); });
+  #endif
+#endif
 
   // native usb serial too
   if (ARDUINO_USB_CDC_ON_BOOT) {
@@ -95,7 +131,8 @@ bool DebugController::setup()
     has_coredump = true;
     YBP.println("WARNING: Coredump Found.");
 
-    saveCoreDumpToFile("/coredump.bin");
+    // copying it out of flash is slow, don't hold up startup
+    xTaskCreate(_saveCoreDumpTask, "coredump", 4096, this, 1, NULL);
   }
 
   // esp_register_freertos_tick_hook_for_cpu(core0_tick_cb, 0);
@@ -116,13 +153,26 @@ bool DebugController::setup()
 
 void DebugController::loop()
 {
-  // reset our loop times every minute.
-  if (INTERVAL(60000))
-    it.reset();
+  // the app scheduler runs us once a minute, so reset our loop times.
+  it.reset();
+
+  for (const auto& entry : _app.getControllers())
+    entry.controller->getTiming().worst_us = 0;
 }
 
 void DebugController::generateStatsHook(JsonVariant output)
 {
+  generateTimerStats(output);
+
+  // every get_stats sees a fresh window
+  if (reset_timer_on_read)
+    it.reset();
+}
+
+void DebugController::generateTimerStats(JsonVariant output)
+{
+  generateBudgetStats(output);
+
   if (it.getEntries().empty())
     return;
 
@@ -132,15 +182,92 @@ void DebugController::generateStatsHook(JsonVariant output)
     if (e.count == 0)
       continue;
 
-    const uint32_t avg_us = static_cast<uint32_t>(e.total_us / e.count);
-
     JsonObject entry = times.add<JsonObject>();
     entry["name"] = e.label;
-    entry["usec"] = avg_us;
+    entry["usec"] = e.average();
     entry["count"] = e.count;
+    entry["min"] = e.min_us;
+    entry["max"] = e.max_us;
+    entry["p50"] = e.percentile(50);
+    entry["p90"] = e.percentile(90);
+    entry["p99"] = e.percentile(99);
+  }
+}
+
+void DebugController::generateBudgetStats(JsonVariant output)
+{
+  // worst offenders first: over budget, then slowest
+  etl::vector<BaseController*, YB_MAX_CONTROLLERS> sorted;
+  uint32_t overruns = 0;
+  uint32_t deferred = 0;
+  for (const auto& entry : _app.getControllers()) {
+    const ControllerTiming& t = entry.controller->getTiming();
+    overruns += t.overruns;
+    deferred += t.deferred;
+    if (t.worst_us)
+      sorted.push_back(entry.controller);
+  }
+
+  std::sort(sorted.begin(), sorted.end(), [](BaseController* a, BaseController* b) {
+    const ControllerTiming& ta = a->getTiming();
+    const ControllerTiming& tb = b->getTiming();
+    if (ta.overruns != tb.overruns)
+      return ta.overruns > tb.overruns;
+    return ta.worst_us > tb.worst_us;
+  });
+
+  JsonObject budget = output["loop_budget"].to<JsonObject>();
+  budget["frame_us"] = _app.loop_budget_us;
+  budget["overruns"] = overruns;
+  budget["deferred"] = deferred;
+
+  JsonArray worst = budget["worst"].to<JsonArray>();
+  for (size_t i = 0; i < sorted.size() && i < YB_BUDGET_REPORT_COUNT; i++) {
+    const ControllerTiming& t = sorted[i]->getTiming();
+
+    JsonObject jo = worst.add<JsonObject>();
+    jo["name"] = sorted[i]->getName();
+    jo["worst_us"] = t.worst_us;
+    jo["budget_us"] = t.budget_us;
+    jo["overruns"] = t.overruns;
+    jo["deferred"] = t.deferred;
   }
 }
 
+bool DebugController::handleBenchmark(JsonVariantConst input, JsonVariant output, ProtocolContext context, ProtocolReply reply)
+{
+  uint32_t iterations = input["iterations"] | 1000;
+  if (iterations < 1 || iterations > 100000) {
+    ProtocolController::generateErrorJSON(output, "'iterations' must be between 1 and 100000.");
+    return false;
+  }
+
+  // runs on the worker, the cases that need the loop's state borrow it in short batches
+  bool started = _app.protocol.runAsync(reply, input, [this, iterations](JsonVariantConst input, JsonVariant output) {
+    YarrboardBenchmark benchmark(_app);
+    benchmark.run(output, iterations);
+  });
+
+  if (!started)
+    ProtocolController::generateErrorJSON(output, "Can't run the benchmark right now, try again.");
+
+  return started;
+}
+
+void DebugController::handleSetTracing(JsonVariantConst input, JsonVariant output, ProtocolContext context)
+{
+  if (!input["enabled"].is<bool>())
+    return ProtocolController::generateErrorJSON(output, "'enabled' is a required parameter.");
+
+  if (input["clear"] | false)
+    YarrboardTrace::clear();
+
+  if (!YarrboardTrace::setEnabled(input["enabled"]))
+    return ProtocolController::generateErrorJSON(output, "Unable to allocate trace buffers.");
+
+  ProtocolController::generateSuccessJSON(output, YarrboardTrace::isEnabled() ? "Tracing enabled." : "Tracing disabled.");
+}
+
 void DebugController::handleCrashMe(JsonVariantConst input, JsonVariant output)
 {
   crashMeHard();
@@ -193,6 +320,18 @@ bool DebugController::checkCoreDump()
     return false;
 }
 
+void DebugController::_saveCoreDumpTask(void* pv)
+{
+  DebugController* debug = (DebugController*)pv;
+
+  if (debug->saveCoreDumpToFile("/coredump.bin"))
+    YBP.println("Coredump saved to /coredump.bin");
+  else
+    YBP.println("ERROR: Unable to save coredump");
+
+  vTaskDelete(NULL);
+}
+
 bool DebugController::saveCoreDumpToFile(const char* path)
 {
   size_t size = 0, address = 0;
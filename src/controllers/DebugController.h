@@ -15,6 +15,7 @@
 
 #include "IntervalTimer.h"
 #include "controllers/BaseController.h"
+#include "controllers/ProtocolController.h"
 
 class YarrboardApp;
 class ConfigManager;
@@ -26,11 +27,19 @@ class DebugController : public BaseController
 
     IntervalTimer it;
 
+    // clear the loop timer each time get_stats reads it, instead of once a minute
+    bool reset_timer_on_read = false;
+
     bool setup() override;
     void loop() override;
     void generateStatsHook(JsonVariant output) override;
 
+    // the stats without the reset_timer_on_read side effect
+    void generateTimerStats(JsonVariant output);
+
     void handleCrashMe(JsonVariantConst input, JsonVariant output);
+    bool handleBenchmark(JsonVariantConst input, JsonVariant output, ProtocolContext context, ProtocolReply reply);
+    void handleSetTracing(JsonVariantConst input, JsonVariant output, ProtocolContext context);
 
     String getResetReason();
     bool checkCoreDump();
@@ -44,6 +53,8 @@ class DebugController : public BaseController
     bool has_coredump = false;
 
     void crashMeHard();
+    static void _saveCoreDumpTask(void* pv);
+    void generateBudgetStats(JsonVariant output);
 };
 
 #endif /* !YARR_DEBUG_CONTROLLER_H */
\ No newline at end of file
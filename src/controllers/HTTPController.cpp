@@ -11,13 +11,16 @@
  */
 
 #include "controllers/HTTPController.h"
+#include "ChunkedPrint.h"
 #include "ConfigManager.h"
 #include "YarrboardApp.h"
 #include "YarrboardDebug.h"
+#include "YarrboardTrace.h"
 #include "controllers/ProtocolController.h"
 
 HTTPController::HTTPController(YarrboardApp& app) : BaseController(app, "http")
 {
+  _needs = YB_NEEDS_CONFIG | YB_NEEDS_WIFI;
 }
 
 void HTTPController::registerGulpedFile(const GulpedFile* file, const char* path /* = nullptr */)
@@ -134,7 +137,7 @@ bool HTTPController::setup()
 
   // Our websocket handler
   websocketHandler.onFrame([this](PsychicWebSocketRequest* request, httpd_ws_frame* frame) {
-    handleWebSocketMessage(request, frame->payload, frame->len);
+    handleWebSocketMessage(request, frame->payload, frame->len, frame->type == HTTPD_WS_TYPE_BINARY);
     return ESP_OK;
   });
   websocketHandler.onOpen([this](PsychicWebSocketClient* client) {
@@ -146,6 +149,12 @@ bool HTTPController::setup()
     // YBP.printf("[socket] connection #%u closed from %s\n", client->socket(),
     //               client->remoteIP().toString());
     _app.auth.removeClientFromAuthList(client->socket());
+    // sockets get reused, so forget the encoding too
+    _app.auth.setClientEncoding(client->socket(), YB_ENCODING_JSON);
+    _app.protocol.updateDelta.forget(YBP_MODE_WEBSOCKET, client->socket());
+    _app.protocol.unsubscribeAll(client->socket());
+    _app.protocol.cancelReplies(client->socket());
+    forgetBucket(client->socket());
     websocketClientCount--;
   });
   server->on("/ws", &websocketHandler);
@@ -156,7 +165,7 @@ bool HTTPController::setup()
 
   // our main api connection
   server->on("/api/endpoint", HTTP_ANY, [this](PsychicRequest* request, PsychicResponse* response) {
-    JsonDocument json;
+    JsonDocument json(&jsonPool);
 
     String body = request->body();
     DeserializationError err = deserializeJson(json, body);
@@ -168,9 +177,15 @@ bool HTTPController::setup()
 
   // send config json
   server->on("/api/config", HTTP_ANY, [this](PsychicRequest* request, PsychicResponse* response) {
-    JsonDocument json;
+    JsonDocument json(&jsonPool);
     json["cmd"] = "get_config";
 
+    // browsers send back our ETag quoted
+    String etag = request->header("If-None-Match");
+    etag.replace("\"", "");
+    if (etag.length())
+      json["if_none_match"] = etag;
+
     handleWebServerRequest(json, request, response);
 
     return ESP_OK;
@@ -178,7 +193,7 @@ bool HTTPController::setup()
 
   // send stats json
   server->on("/api/stats", HTTP_ANY, [this](PsychicRequest* request, PsychicResponse* response) {
-    JsonDocument json;
+    JsonDocument json(&jsonPool);
     json["cmd"] = "get_stats";
 
     handleWebServerRequest(json, request, response);
@@ -188,7 +203,7 @@ bool HTTPController::setup()
 
   // send update json
   server->on("/api/update", HTTP_ANY, [this](PsychicRequest* request, PsychicResponse* response) {
-    JsonDocument json;
+    JsonDocument json(&jsonPool);
     json["cmd"] = "get_update";
 
     handleWebServerRequest(json, request, response);
@@ -196,6 +211,29 @@ bool HTTPController::setup()
     return ESP_OK;
   });
 
+#ifndef YB_DISABLE_TRACE
+  // timeline of recent trace spans, load it in https://ui.perfetto.dev
+  server->on("/trace.json", HTTP_GET, [this](PsychicRequest* request, PsychicResponse* response) {
+    // task names and timings are admin only, same as set_tracing
+    if (_app.auth.getUserRole(JsonVariantConst(), YBP_MODE_HTTP, request->client()->socket()) < ADMIN) {
+      response->setCode(403);
+      response->setContent("Access denied.");
+      return response->send();
+    }
+
+    if (!YarrboardTrace::isEnabled()) {
+      response->setCode(404);
+      response->setContent("Tracing is disabled.");
+      return response->send();
+    }
+
+    PsychicStreamResponse stream(response, "application/json");
+    stream.beginSend();
+    YarrboardTrace::writeJSON(stream);
+    return stream.endSend();
+  });
+#endif
+
   // downloadable coredump file
   server->on("/coredump.bin", HTTP_GET, [this](PsychicRequest* request, PsychicResponse* response) {
     _app.debug.deleteCoreDump(); // clear ESP flash dump
@@ -221,40 +259,189 @@ void HTTPController::loop()
   // process our websockets outside the callback.
   WebsocketRequest request;
   while (xQueueReceive(wsRequests, &request, 0) == pdTRUE) {
+    YB_TRACE_RECORD("ws.queue_wait", request.queued_us, esp_timer_get_time());
+    releaseFrame(request.socket);
     handleWebsocketMessageLoop(&request);
 
     // make sure to release our memory!
-    free(request.buffer);
+    jsonPool.deallocate(request.buffer);
+  }
+}
+
+unsigned int HTTPController::websocketQueueDepth()
+{
+  return wsRequests ? uxQueueMessagesWaiting(wsRequests) : 0;
+}
+
+// runs on the http task, so keep it quick
+bool HTTPController::admitFrame(int socket, uint32_t& retry_ms, bool& notify)
+{
+  UserRole role = _app.auth.getUserRole(JsonVariantConst(), YBP_MODE_WEBSOCKET, socket);
+
+  float rate, burst;
+  if (role == ADMIN) {
+    rate = YB_WS_RATE_ADMIN;
+    burst = YB_WS_BURST_ADMIN;
+  } else if (role == GUEST) {
+    rate = YB_WS_RATE_GUEST;
+    burst = YB_WS_BURST_GUEST;
+  } else {
+    rate = YB_WS_RATE_NOBODY;
+    burst = YB_WS_BURST_NOBODY;
+  }
+
+  // everybody gets an equal slice of the queue
+  unsigned int clients = websocketClientCount ? websocketClientCount : 1;
+  unsigned int share = max((unsigned int)YB_WS_MIN_QUEUE_SHARE, (unsigned int)YB_RECEIVE_BUFFER_COUNT / clients);
+
+  int64_t now = esp_timer_get_time();
+  bool admit = true;
+  notify = false;
+
+  taskENTER_CRITICAL(&bucketLock);
+
+  WebsocketBucket* bucket = nullptr;
+  for (auto& b : buckets) {
+    if (b.socket == socket) {
+      bucket = &b;
+      break;
+    }
+  }
+
+  if (!bucket && !buckets.full()) {
+    buckets.push_back({socket, burst, now, 0, false});
+    bucket = &buckets.back();
+  }
+
+  if (bucket) {
+    if (rate > 0) {
+      bucket->tokens = min(burst, bucket->tokens + (now - bucket->refilled_us) * rate / 1000000.0f);
+      bucket->refilled_us = now;
+    }
+
+    if ((rate > 0 && bucket->tokens < 1) || bucket->queued >= share) {
+      admit = false;
+
+      // time until they have a token, or a guess for the queue to drain
+      if (rate > 0 && bucket->tokens < 1)
+        retry_ms = (uint32_t)((1 - bucket->tokens) * 1000 / rate) + 1;
+      else
+        retry_ms = 100;
+
+      // only say it once per episode
+      notify = !bucket->throttled;
+      bucket->throttled = true;
+    } else {
+      if (rate > 0)
+        bucket->tokens -= 1;
+      bucket->queued++;
+      bucket->throttled = false;
+    }
   }
+
+  taskEXIT_CRITICAL(&bucketLock);
+
+  return admit;
 }
 
-void HTTPController::sendToAllWebsockets(const char* jsonString, UserRole auth_level)
+void HTTPController::releaseFrame(int socket)
+{
+  taskENTER_CRITICAL(&bucketLock);
+  for (auto& b : buckets) {
+    if (b.socket == socket) {
+      if (b.queued)
+        b.queued--;
+      break;
+    }
+  }
+  taskEXIT_CRITICAL(&bucketLock);
+}
+
+void HTTPController::forgetBucket(int socket)
+{
+  taskENTER_CRITICAL(&bucketLock);
+  for (auto it = buckets.begin(); it != buckets.end(); ++it) {
+    if (it->socket == socket) {
+      buckets.erase(it);
+      break;
+    }
+  }
+  taskEXIT_CRITICAL(&bucketLock);
+}
+
+void HTTPController::sendThrottle(PsychicWebSocketRequest* request, uint32_t retry_ms)
+{
+  websocketThrottled++;
+
+  PsychicWebSocketClient* client = websocketHandler.getClient(request->client()->socket());
+  if (client == NULL)
+    return;
+
+  JsonDocument doc(&jsonPool);
+  doc["msg"] = "throttle";
+  doc["retry_ms"] = retry_ms;
+
+  // same wire format as the rest of their replies
+  bool pack = _app.auth.getClientEncoding(client->socket()) == YB_ENCODING_MSGPACK;
+
+  // we're on httpd here, don't land in the middle of a fragmented reply.
+  // if a big reply is going out, skip the notice rather than stall httpd
+  if (sendMutex == NULL || xSemaphoreTake(sendMutex, pdMS_TO_TICKS(10)) != pdTRUE)
+    return;
+
+  streamToWebsocket(client, doc, pack);
+  xSemaphoreGive(sendMutex);
+}
+
+void HTTPController::sendToAllWebsockets(const char* jsonString, UserRole auth_level, JsonVariantConst output)
 {
   // if the mutex hasn't been created yet, we're not ready to send
   if (sendMutex == NULL) {
     return;
   }
 
+  // only pay for msgpack if someone asked for it
+  uint8_t* packBuffer = NULL;
+  size_t packSize = 0;
+  if (_app.auth.hasMsgPackClients()) {
+    JsonDocument doc(&jsonPool);
+    if (output.isNull()) {
+      deserializeJson(doc, jsonString);
+      output = doc.as<JsonVariantConst>();
+    }
+
+    packSize = measureMsgPack(output);
+    packBuffer = (uint8_t*)jsonPool.allocate(packSize);
+    if (packBuffer == NULL) {
+      // dont use YBP here because it will get recursive.
+      YBP.println("Error allocating in sendToAllWebsockets()");
+      return;
+    }
+
+    YB_TRACE_SCOPE("msgpack.serialize");
+    serializeMsgPack(output, packBuffer, packSize);
+  }
+
   // make sure we're allowed to see the message
   if (auth_level > _cfg.app_default_role) {
-    for (byte i = 0; i < YB_CLIENT_LIMIT; i++) {
-      if (_app.auth.authenticatedClients[i].socket) {
-        // make sure its a valid client
-        PsychicWebSocketClient* client =
-          websocketHandler.getClient(_app.auth.authenticatedClients[i].socket);
-        if (client == NULL)
-          continue;
-
-        if (_app.auth.authenticatedClients[i].role >= auth_level) {
-          if (xSemaphoreTake(sendMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-            client->sendMessage(jsonString);
-            xSemaphoreGive(sendMutex);
-          } else {
-            // dont use YBP here because it will get recursive.
-            Serial.println("client->sendMessage mutex fail");
-          }
-        }
-      }
+    for (auto& authClient : _app.auth.authenticatedClients) {
+      if (authClient.role < auth_level)
+        continue;
+
+      // make sure its a valid client
+      PsychicWebSocketClient* client = websocketHandler.getClient(authClient.socket);
+      if (client == NULL)
+        continue;
+
+      sendToWebsocket(client, jsonString, packBuffer, packSize);
+    }
+  }
+  // mixed encodings, so we have to go one by one
+  else if (packBuffer != NULL) {
+    for (PsychicClient* pc : websocketHandler.getClientList()) {
+      PsychicWebSocketClient* client = websocketHandler.getClient(pc);
+      if (client != NULL)
+        sendToWebsocket(client, jsonString, packBuffer, packSize);
     }
   }
   // nope, just send it to all.
@@ -264,23 +451,87 @@ void HTTPController::sendToAllWebsockets(const char* jsonString, UserRole auth_l
       xSemaphoreGive(sendMutex);
     } else {
       // dont use YBP here because it will get recursive.
-      Serial.println("websocketHandler.sendAll mutex fail");
+      YBP.println("websocketHandler.sendAll mutex fail");
     }
   }
+
+  jsonPool.deallocate(packBuffer);
+}
+
+void HTTPController::sendToWebsockets(JsonVariantConst output, const int* sockets, size_t count)
+{
+  if (sendMutex == NULL)
+    return;
+
+  // only pack it if one of them wants msgpack
+  bool needPack = false;
+  for (size_t i = 0; i < count; i++)
+    if (_app.auth.getClientEncoding(sockets[i]) == YB_ENCODING_MSGPACK)
+      needPack = true;
+
+  size_t jsonSize = measureJson(output);
+  char* jsonBuffer = (char*)jsonPool.allocate(jsonSize + 1);
+  size_t packSize = needPack ? measureMsgPack(output) : 0;
+  uint8_t* packBuffer = needPack ? (uint8_t*)jsonPool.allocate(packSize) : NULL;
+
+  if (jsonBuffer == NULL || (needPack && packBuffer == NULL)) {
+    // dont use YBP here because it will get recursive.
+    YBP.println("Error allocating in sendToWebsockets()");
+    jsonPool.deallocate(jsonBuffer);
+    jsonPool.deallocate(packBuffer);
+    return;
+  }
+
+  {
+    YB_TRACE_SCOPE("json.serialize");
+    serializeJson(output, jsonBuffer, jsonSize + 1);
+  }
+  if (needPack) {
+    YB_TRACE_SCOPE("msgpack.serialize");
+    serializeMsgPack(output, packBuffer, packSize);
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    PsychicWebSocketClient* client = websocketHandler.getClient(sockets[i]);
+    if (client != NULL)
+      sendToWebsocket(client, jsonBuffer, packBuffer, packSize);
+  }
+
+  jsonPool.deallocate(jsonBuffer);
+  jsonPool.deallocate(packBuffer);
+}
+
+void HTTPController::sendToWebsocket(PsychicWebSocketClient* client, const char* jsonString, const uint8_t* packBuffer, size_t packSize)
+{
+  bool binary = packBuffer != NULL && _app.auth.getClientEncoding(client->socket()) == YB_ENCODING_MSGPACK;
+
+  if (xSemaphoreTake(sendMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
+    if (binary)
+      client->sendMessage(HTTPD_WS_TYPE_BINARY, packBuffer, packSize);
+    else
+      client->sendMessage(jsonString);
+    xSemaphoreGive(sendMutex);
+  } else {
+    // dont use YBP here because it will get recursive.
+    YBP.println("client->sendMessage mutex fail");
+  }
 }
 
 esp_err_t HTTPController::handleWebServerRequest(JsonVariant input, PsychicRequest* request, PsychicResponse* response)
 {
   esp_err_t err = ESP_OK;
-  JsonDocument output;
+  JsonDocument output(&jsonPool);
+
+  // batches log in with the first command
+  JsonVariant credentials = input.is<JsonArray>() ? input[0] : input;
 
   if (request->hasParam("user"))
-    input["user"] = request->getParam("user")->value();
+    credentials["user"] = request->getParam("user")->value();
   if (request->hasParam("pass"))
-    input["pass"] = request->getParam("pass")->value();
+    credentials["pass"] = request->getParam("pass")->value();
 
   if (_cfg.app_enable_api) {
-    _app.auth.isApiClientLoggedIn(input);
+    _app.auth.isApiClientLoggedIn(credentials);
 
     ProtocolContext context;
     context.mode = YBP_MODE_HTTP;
@@ -290,28 +541,25 @@ esp_err_t HTTPController::handleWebServerRequest(JsonVariant input, PsychicReque
   } else
     _app.protocol.generateErrorJSON(output, "Web API is disabled.");
 
+  // config responses carry an ETag for conditional requests
+  if (output["msg"] == "config" && output["config_etag"].is<const char*>()) {
+    String etag = "\"" + output["config_etag"].as<String>() + "\"";
+    response->addHeader("ETag", etag.c_str());
+
+    if (output["not_modified"])
+      return response->send(304);
+  }
+
   // we can have empty messages
   if (output.size()) {
-    // allocate memory for this output
-    size_t jsonSize = measureJson(output);
-    char* jsonBuffer = (char*)malloc(jsonSize + 1);
-
-    // did we get anything?
-    if (jsonBuffer != NULL) {
-      jsonBuffer[jsonSize] = '\0'; // null terminate
-      response->setContentType("application/json");
-      serializeJson(output.as<JsonObject>(), jsonBuffer, jsonSize + 1);
-      response->setContent(jsonBuffer);
-      err = response->send();
+    // chunked transfer, so there is never a full size copy of the reply
+    PsychicStreamResponse stream(response, "application/json");
+    err = stream.beginSend();
+    if (err == ESP_OK) {
+      YB_TRACE_SCOPE("json.serialize");
+      serializeJson(output, stream);
+      err = stream.endSend();
     }
-    // send overloaded response
-    else {
-      YBP.println("Error allocating in handleWebServerRequest()");
-      err = response->send(503, "application/json", "{}");
-    }
-
-    // no leaks!
-    free(jsonBuffer);
   }
   // give them valid json at least
   else
@@ -321,18 +569,35 @@ esp_err_t HTTPController::handleWebServerRequest(JsonVariant input, PsychicReque
 }
 
 void HTTPController::handleWebSocketMessage(PsychicWebSocketRequest* request, uint8_t* data,
-  size_t len)
+  size_t len, bool binary)
 {
+  int socket = request->client()->socket();
+
+  // slow down there, cowboy
+  uint32_t retry_ms = 0;
+  bool notify = false;
+  if (!admitFrame(socket, retry_ms, notify)) {
+    websocketDropped++;
+    if (notify)
+      sendThrottle(request, retry_ms);
+    return;
+  }
+
   // build our websocket request - copy the existing one
   // we are allocating memory here, and the worker will free it
   WebsocketRequest wr;
-  wr.socket = request->client()->socket();
+  wr.socket = socket;
   wr.len = len + 1;
-  wr.buffer = (char*)malloc(len + 1);
+#ifndef YB_DISABLE_TRACE
+  wr.queued_us = esp_timer_get_time();
+#endif
+  wr.binary = binary;
+  wr.buffer = (char*)jsonPool.allocate(len + 1);
 
   // did we flame out?
   if (wr.buffer == NULL) {
     YBP.printf("Queue message: unable to allocate %d bytes\n", len + 1);
+    releaseFrame(socket);
     return;
   }
 
@@ -341,16 +606,16 @@ void HTTPController::handleWebSocketMessage(PsychicWebSocketRequest* request, ui
 
   // throw it in our queue
   if (xQueueSend(wsRequests, &wr, 1) != pdTRUE) {
-    // request->client()->close();
     YBP.printf("[socket] queue full #%d\n", wr.socket);
 
     // free the memory... no worker to do it for us.
-    free(wr.buffer);
-  }
+    jsonPool.deallocate(wr.buffer);
+    releaseFrame(socket);
 
-  // send a throttle message if we're full
-  if (!uxQueueSpacesAvailable(wsRequests))
-    request->reply("{\"error\":\"Queue Full\"}");
+    websocketDropped++;
+    sendThrottle(request, 100);
+  } else
+    signal();
 }
 
 void HTTPController::handleWebsocketMessageLoop(WebsocketRequest* request)
@@ -362,14 +627,20 @@ void HTTPController::handleWebsocketMessageLoop(WebsocketRequest* request)
     return;
   }
 
-  JsonDocument output;
-  JsonDocument input;
+  JsonDocument output(&jsonPool);
+  JsonDocument input(&jsonPool);
+
+  // binary frames are msgpack, text frames are json
+  DeserializationError err;
+  if (request->binary)
+    err = deserializeMsgPack(input, request->buffer, request->len - 1);
+  else
+    err = deserializeJson(input, request->buffer);
 
   // was there a problem, officer?
-  DeserializationError err = deserializeJson(input, request->buffer);
   if (err) {
     char error[64];
-    sprintf(error, "deserializeJson() failed with code %s", err.c_str());
+    sprintf(error, "%s() failed with code %s", request->binary ? "deserializeMsgPack" : "deserializeJson", err.c_str());
     _app.protocol.generateErrorJSON(output, error);
   } else {
     ProtocolContext context;
@@ -380,29 +651,55 @@ void HTTPController::handleWebsocketMessageLoop(WebsocketRequest* request)
 
   // empty messages are valid, so don't send a response
   if (output.size()) {
-    // allocate memory for this output
-    size_t jsonSize = measureJson(output);
-    char* jsonBuffer = (char*)malloc(jsonSize + 1);
-
-    // did we get anything?
-    if (jsonBuffer != NULL) {
-      serializeJson(output, jsonBuffer, jsonSize + 1);
-      jsonBuffer[jsonSize] = '\0'; // null terminate
-
-      if (xSemaphoreTake(sendMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        client->sendMessage(jsonBuffer);
-        xSemaphoreGive(sendMutex);
-      } else {
-        Serial.println("handleWebsocketMessageLoop send mutex fail");
-      }
+    // reply in whatever the client asked for in hello
+    bool pack = _app.auth.getClientEncoding(client->socket()) == YB_ENCODING_MSGPACK;
 
-      _app.protocol.incrementSentMessages();
-
-      free(jsonBuffer);
+    // the fragments of one message can't get mixed up with anything else
+    if (xSemaphoreTake(sendMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+      if (!streamToWebsocket(client, output, pack))
+        YBP.println("handleWebsocketMessageLoop send failed");
+      xSemaphoreGive(sendMutex);
     } else {
-      YBP.println("Error allocating in handleWebsocketMessageLoop()");
+      YBP.println("handleWebsocketMessageLoop send mutex fail");
     }
+
+    _app.protocol.incrementSentMessages();
+  }
+}
+
+bool HTTPController::streamToWebsocket(PsychicWebSocketClient* client, JsonVariantConst output, bool pack)
+{
+  uint8_t* chunk = (uint8_t*)jsonPool.allocate(YB_STREAM_CHUNK_SIZE);
+  if (chunk == NULL)
+    return false;
+
+  // first chunk sets the message type, the rest are continuation frames
+  bool first = true;
+  ChunkedPrint writer(chunk, YB_STREAM_CHUNK_SIZE, [&](const uint8_t* data, size_t len, bool final) {
+    httpd_ws_frame_t frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.type = first ? (pack ? HTTPD_WS_TYPE_BINARY : HTTPD_WS_TYPE_TEXT) : HTTPD_WS_TYPE_CONTINUE;
+    frame.final = final;
+    frame.fragmented = !(first && final);
+    frame.payload = (uint8_t*)data;
+    frame.len = len;
+    first = false;
+
+    return client->sendMessage(&frame) == ESP_OK;
+  });
+
+  if (pack) {
+    YB_TRACE_SCOPE("msgpack.serialize");
+    serializeMsgPack(output, writer);
+  } else {
+    YB_TRACE_SCOPE("json.serialize");
+    serializeJson(output, writer);
   }
+
+  bool ok = writer.finish();
+  jsonPool.deallocate(chunk);
+
+  return ok;
 }
 
 esp_err_t HTTPController::handleGulpedFile(PsychicRequest* request, PsychicResponse* response)
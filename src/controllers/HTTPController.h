@@ -24,6 +24,7 @@
 #include <PsychicHttpsServer.h>
 #include <freertos/queue.h>
 #include <etl/map.h>
+#include <etl/vector.h>
 
 #define MAX_GULPED_FILES 32
 
@@ -31,8 +32,21 @@ typedef struct {
     int socket;
     char* buffer;
     size_t len;
+#ifndef YB_DISABLE_TRACE
+    int64_t queued_us; // for tracing the queue wait
+#endif
+    bool binary; // msgpack frame instead of json text
 } WebsocketRequest;
 
+// token bucket + queue share for one websocket
+typedef struct {
+    int socket;
+    float tokens;
+    int64_t refilled_us;
+    uint16_t queued; // frames of theirs sitting in wsRequests
+    bool throttled;  // already told them to back off
+} WebsocketBucket;
+
 class YarrboardApp;
 class ConfigManager;
 
@@ -44,7 +58,10 @@ class HTTPController : public BaseController
     bool setup() override;
     void loop() override;
 
-    void sendToAllWebsockets(const char* jsonString, UserRole auth_level);
+    // pass the original output too if you have it, saves re-parsing for msgpack clients
+    void sendToAllWebsockets(const char* jsonString, UserRole auth_level, JsonVariantConst output = JsonVariantConst());
+    // serialize once, send to just these sockets
+    void sendToWebsockets(JsonVariantConst output, const int* sockets, size_t count);
     void registerGulpedFile(const GulpedFile* file, const char* path = nullptr);
     void registerGulpedFiles(const GulpedFile* files[], int count);
 
@@ -54,13 +71,26 @@ class HTTPController : public BaseController
     unsigned int websocketClientCount = 0;
     unsigned int httpClientCount = 0;
 
+    // frames we dropped for rate limiting, and throttle messages we sent
+    uint32_t websocketDropped = 0;
+    uint32_t websocketThrottled = 0;
+    unsigned int websocketQueueDepth();
+
   private:
     PsychicHttpServer* server;
     PsychicWebSocketHandler websocketHandler;
     char last_modified[50];
-    QueueHandle_t wsRequests;
+    QueueHandle_t wsRequests = NULL;
     SemaphoreHandle_t sendMutex;
 
+    etl::vector<WebsocketBucket, YB_CLIENT_LIMIT> buckets;
+    portMUX_TYPE bucketLock = portMUX_INITIALIZER_UNLOCKED;
+
+    bool admitFrame(int socket, uint32_t& retry_ms, bool& notify);
+    void releaseFrame(int socket);
+    void forgetBucket(int socket);
+    void sendThrottle(PsychicWebSocketRequest* request, uint32_t retry_ms);
+
     struct CStringCompare {
         bool operator()(const char* a, const char* b) const {
             return strcmp(a, b) < 0;
@@ -70,7 +100,9 @@ class HTTPController : public BaseController
 
     void handleWebsocketMessageLoop(WebsocketRequest* request);
     esp_err_t handleWebServerRequest(JsonVariant input, PsychicRequest* request, PsychicResponse* response);
-    void handleWebSocketMessage(PsychicWebSocketRequest* request, uint8_t* data, size_t len);
+    void handleWebSocketMessage(PsychicWebSocketRequest* request, uint8_t* data, size_t len, bool binary);
+    void sendToWebsocket(PsychicWebSocketClient* client, const char* jsonString, const uint8_t* packBuffer, size_t packSize);
+    bool streamToWebsocket(PsychicWebSocketClient* client, JsonVariantConst output, bool pack);
     esp_err_t handleGulpedFile(PsychicRequest* request, PsychicResponse* response);
 };
 
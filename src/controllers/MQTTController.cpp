@@ -14,12 +14,14 @@
 #include "ConfigManager.h"
 #include "YarrboardApp.h"
 #include "YarrboardDebug.h"
+#include "YarrboardTrace.h"
 #include "controllers/ProtocolController.h"
 
 MQTTController* MQTTController::_instance = nullptr;
 
 MQTTController::MQTTController(YarrboardApp& app) : BaseController(app, "mqtt")
 {
+  _needs = YB_NEEDS_CONFIG | YB_NEEDS_WIFI;
 }
 
 bool MQTTController::setup()
@@ -29,7 +31,7 @@ bool MQTTController::setup()
     return false;
   }
 
-  _app.protocol.registerCommand(ADMIN, "set_mqtt_config", this, &MQTTController::handleSetMQTTConfig);
+  _app.protocol.registerAsyncCommand(ADMIN, "set_mqtt_config", this, &MQTTController::handleSetMQTTConfig);
 
   _instance = this; // Capture the instance for callbacks
 
@@ -50,7 +52,8 @@ bool MQTTController::setup()
     });
   }
 
-  return connect(true);
+  // don't hold up startup, onConnect() / onError() tell us how it went
+  return connect(false);
 }
 
 bool MQTTController::connect(bool waitBlocking)
@@ -92,31 +95,31 @@ bool MQTTController::connect(bool waitBlocking)
 
 void MQTTController::loop()
 {
-  if (!mqttClient.connected())
-    return;
+  // onConnect() runs on the mqtt task, answer set_mqtt_config from here
+  if (_connected.exchange(false))
+    finishConnectReply(nullptr);
 
-  // periodically update our mqtt / HomeAssistant status
-  unsigned int messageDelta = millis() - previousMQTTMillis;
-  if (messageDelta >= 1000) {
-    if (mqttClient.connected()) {
+  // still no broker for set_mqtt_config?
+  if (_connectReply.isValid() && millis() - _connectStarted >= YB_MQTT_CONNECT_TIMEOUT_MS)
+    finishConnectReply("Error connecting to MQTT server.");
 
-      for (const auto& entry : _app.getControllers()) {
-        entry.controller->mqttUpdateHook(this);
-      }
+  // the app scheduler calls us every second (or right after connecting)
+  if (!mqttClient.connected())
+    return;
 
-      // separately update our Home Assistant status
-      if (_cfg.app_enable_ha_integration) {
-        for (const auto& entry : _app.getControllers()) {
-          entry.controller->haUpdateHook(this);
-        }
-      }
-    }
+  _app.forEachHook(YB_HOOK_MQTT_UPDATE, [&](BaseController* controller) {
+    controller->mqttUpdateHook(this);
+  });
 
-    previousMQTTMillis = millis();
+  // separately update our Home Assistant status
+  if (_cfg.app_enable_ha_integration) {
+    _app.forEachHook(YB_HOOK_HA_UPDATE, [&](BaseController* controller) {
+      controller->haUpdateHook(this);
+    });
   }
 }
 
-void MQTTController::handleSetMQTTConfig(JsonVariantConst input, JsonVariant output, ProtocolContext context)
+bool MQTTController::handleSetMQTTConfig(JsonVariantConst input, JsonVariant output, ProtocolContext context, ProtocolReply reply)
 {
   _cfg.app_enable_mqtt = input["app_enable_mqtt"];
   _cfg.app_enable_mqtt_protocol = input["app_enable_mqtt_protocol"];
@@ -130,16 +133,45 @@ void MQTTController::handleSetMQTTConfig(JsonVariantConst input, JsonVariant out
 
   // save it to file.
   char error[128] = "Unknown";
-  if (!_cfg.saveConfig(error, sizeof(error)))
-    return _app.protocol.generateErrorJSON(output, error);
+  if (!_cfg.saveConfig(error, sizeof(error))) {
+    _app.protocol.generateErrorJSON(output, error);
+    return false;
+  }
 
   // init our mqtt
   if (_cfg.app_enable_mqtt) {
     disconnect(); // reset our connection.
-    if (!connect())
-      return _app.protocol.generateErrorJSON(output, "Error connecting to MQTT server.");
-  } else
-    disconnect();
+
+    // loop() answers when we know how it went, so be ready before we connect
+    finishConnectReply("MQTT config changed again.");
+    _connected = false;
+    _connectStarted = millis();
+    _connectReply = reply;
+
+    if (!connect()) {
+      _connectReply = ProtocolReply();
+      _app.protocol.generateErrorJSON(output, "Error connecting to MQTT server.");
+      return false;
+    }
+
+    return true;
+  }
+
+  disconnect();
+  return false;
+}
+
+void MQTTController::finishConnectReply(const char* error)
+{
+  ProtocolReply reply = _connectReply;
+  _connectReply = ProtocolReply();
+  if (!reply.isValid())
+    return;
+
+  JsonDocument output(&jsonPool);
+  if (error != nullptr)
+    _app.protocol.generateErrorJSON(output, error);
+  _app.protocol.complete(reply, output);
 }
 
 void MQTTController::generateStatsHook(JsonVariant output)
@@ -168,6 +200,8 @@ void MQTTController::publish(const char* topic, const char* payload, bool use_pr
   if (!mqttClient.connected())
     return;
 
+  YB_TRACE_SCOPE("mqtt.publish");
+
   int ret;
 
   // prefix it with yarrboard or nah?
@@ -190,9 +224,9 @@ void MQTTController::receiveMessage(const char* topic, const char* payload, int
   if (!_cfg.app_enable_mqtt_protocol)
     return;
 
-  JsonDocument input;
+  JsonDocument input(&jsonPool);
   DeserializationError err = deserializeJson(input, payload);
-  JsonDocument output;
+  JsonDocument output(&jsonPool);
 
   if (err) {
     char error[64];
@@ -205,23 +239,27 @@ void MQTTController::receiveMessage(const char* topic, const char* payload, int
   }
 
   // we can have empty responses
-  if (output.size()) {
-    // dynamically allocate our buffer
-    size_t jsonSize = measureJson(output);
-    char* jsonBuffer = (char*)malloc(jsonSize + 1);
-
-    // did we get anything?
-    if (jsonBuffer != NULL) {
-      jsonBuffer[jsonSize] = '\0'; // null terminate
-      serializeJson(output, jsonBuffer, jsonSize + 1);
-
-      // post our response
-      this->publish("response", jsonBuffer);
-      free(jsonBuffer);
-    } else {
-      // dont call YBP b/c loops...
-      YBP.println("Error allocating in MQTTController::receiveMessage");
-    }
+  if (output.size())
+    sendResponse(output);
+}
+
+void MQTTController::sendResponse(JsonVariantConst output)
+{
+  // dynamically allocate our buffer
+  size_t jsonSize = measureJson(output);
+  char* jsonBuffer = (char*)jsonPool.allocate(jsonSize + 1);
+
+  // did we get anything?
+  if (jsonBuffer != NULL) {
+    jsonBuffer[jsonSize] = '\0'; // null terminate
+    serializeJson(output, jsonBuffer, jsonSize + 1);
+
+    // post our response
+    this->publish("response", jsonBuffer);
+    jsonPool.deallocate(jsonBuffer);
+  } else {
+    // dont call YBP b/c loops...
+    YBP.println("Error allocating in MQTTController::sendResponse");
   }
 }
 
@@ -229,6 +267,9 @@ void MQTTController::_receiveMessageStatic(const char* topic, const char* payloa
 {
   if (_instance) {
     _instance->receiveMessage(topic, payload, retain, qos, dup);
+
+    // commands may have left work for our controllers
+    _instance->_app.wake();
   }
 }
 
@@ -239,6 +280,9 @@ void MQTTController::onConnect(bool sessionPresent)
   // clear first connection flag on successful connection
   _firstConnection = false;
 
+  // the new settings work, loop() tells set_mqtt_config
+  _connected = true;
+
   if (_cfg.app_enable_ha_integration)
     haDiscovery();
 
@@ -246,6 +290,9 @@ void MQTTController::onConnect(bool sessionPresent)
   char mqtt_path[128];
   sprintf(mqtt_path, "yarrboard/%s/command", _cfg.local_hostname);
   mqttClient.onTopic(mqtt_path, 0, _receiveMessageStatic);
+
+  // publish our state right away instead of waiting for the next period
+  signal();
 }
 
 void MQTTController::_onConnectStatic(bool sessionPresent)
@@ -331,9 +378,9 @@ void MQTTController::haDiscovery()
   // our components array
   JsonObject components = doc["cmps"].to<JsonObject>();
 
-  for (const auto& entry : _app.getControllers()) {
-    entry.controller->haGenerateDiscoveryHook(components, ha_dev_uuid, this);
-  }
+  _app.forEachHook(YB_HOOK_HA_DISCOVERY, [&](BaseController* controller) {
+    controller->haGenerateDiscoveryHook(components, ha_dev_uuid, this);
+  });
 
   // dynamically allocate our buffer
   size_t jsonSize = measureJson(doc);
@@ -357,164 +404,7 @@ void MQTTController::haDiscovery()
 
 void MQTTController::traverseJSON(JsonVariant node, const char* topic_prefix)
 {
-  static constexpr size_t TOPIC_CAP = 256;
-  char topicBuf[TOPIC_CAP] = "";
-  strlcpy(topicBuf, topic_prefix, TOPIC_CAP);
-  size_t len = strnlen(topicBuf, TOPIC_CAP);
-
-  traverse_impl(node, topicBuf, TOPIC_CAP, len);
-}
-
-// ---- Internal helpers -------------------------------------------------------
-
-void MQTTController::append_to_topic(char* buf, size_t& len, size_t cap, const char* piece)
-{
-  if (!piece || !piece[0])
-    return;
-  // Add separator if we already have content
-  if (len > 0 && buf[len - 1] != '/' && len + 1 < cap) {
-    buf[len++] = '/';
-  }
-  // Append piece (truncate safely if needed)
-  while (*piece && len + 1 < cap) {
-    buf[len++] = *piece++;
-  }
-  buf[len] = '\0';
-}
-
-void MQTTController::append_index_to_topic(char* buf, size_t& len, size_t cap, size_t index)
-{
-  char ibuf[16];
-  // Enough for size_t up to 64-bit
-  int n = snprintf(ibuf, sizeof(ibuf), "%u", static_cast<unsigned>(index));
-  (void)n; // silence -Wunused-result
-  append_to_topic(buf, len, cap, ibuf);
+  TopicWalker::walk(node, topic_prefix, [](void* context, const char* topic, const char* payload) {
+    static_cast<MQTTController*>(context)->publish(topic, payload);
+  }, this);
 }
-
-// Convert a primitive JsonVariant to char* payload without String
-const char* MQTTController::to_payload(JsonVariant v, char* out, size_t outcap)
-{
-  if (v.isNull()) {
-    // Publish literal "null"
-    if (outcap > 0) {
-      strncpy(out, "null", outcap - 1);
-      out[outcap - 1] = '\0';
-      return out;
-    }
-    return "";
-  }
-
-  // Strings: publish raw C-string (no extra quotes)
-  if (v.is<const char*>()) {
-    const char* s = v.as<const char*>();
-    if (!s)
-      return "";
-    // Copy into out so caller owns stable storage
-    if (outcap > 0) {
-      strncpy(out, s, outcap - 1);
-      out[outcap - 1] = '\0';
-      return out;
-    }
-    return "";
-  }
-
-  // Booleans
-  if (v.is<bool>()) {
-    const char* s = v.as<bool>() ? "true" : "false";
-    if (outcap > 0) {
-      strncpy(out, s, outcap - 1);
-      out[outcap - 1] = '\0';
-      return out;
-    }
-    return "";
-  }
-
-  // Integers (prefer widest to avoid overflow)
-  if (v.is<long long>()) {
-    (void)snprintf(out, outcap, "%lld", v.as<long long>());
-    return out;
-  }
-  if (v.is<unsigned long long>()) {
-    (void)snprintf(out, outcap, "%llu", v.as<unsigned long long>());
-    return out;
-  }
-  if (v.is<long>()) {
-    (void)snprintf(out, outcap, "%ld", v.as<long>());
-    return out;
-  }
-  if (v.is<unsigned long>()) {
-    (void)snprintf(out, outcap, "%lu", v.as<unsigned long>());
-    return out;
-  }
-  if (v.is<int>()) {
-    (void)snprintf(out, outcap, "%d", v.as<int>());
-    return out;
-  }
-  if (v.is<unsigned int>()) {
-    (void)snprintf(out, outcap, "%u", v.as<unsigned int>());
-    return out;
-  }
-
-  // Floating point
-  if (v.is<double>()) {
-    // %.9g gives compact form while preserving good precision
-    (void)snprintf(out, outcap, "%.9g", v.as<double>());
-    return out;
-  }
-  if (v.is<float>()) {
-    (void)snprintf(out, outcap, "%.7g", v.as<float>());
-    return out;
-  }
-
-  // Fallback: serialize JSON representation into out (covers other primitive-ish cases)
-  // (This will include quotes for strings, but we already handled strings above.)
-  serializeJson(v, out, outcap);
-  return out;
-}
-
-// Depth-first traversal with an in-place topic buffer
-void MQTTController::traverse_impl(JsonVariant node, char* topicBuf, size_t cap, size_t curLen)
-{
-  // YBP.printf("traverse_impl: %s\n", topicBuf);
-
-  // Objects
-  if (node.is<JsonObject>()) {
-    JsonObject obj = node.as<JsonObject>();
-    for (JsonPair kv : obj) { // ArduinoJson v7-compatible
-      // Save current length so we can restore after recursion
-      size_t savedLen = curLen;
-
-      // Append key
-      append_to_topic(topicBuf, curLen, cap, kv.key().c_str());
-
-      // Recurse
-      traverse_impl(kv.value(), topicBuf, cap, curLen);
-
-      // Restore topic
-      curLen = savedLen;
-      topicBuf[curLen] = '\0';
-    }
-    return;
-  }
-
-  // Arrays
-  if (node.is<JsonArray>()) {
-    JsonArray arr = node.as<JsonArray>();
-    size_t idx = 0;
-    for (JsonVariant v : arr) {
-      size_t savedLen = curLen;
-      append_index_to_topic(topicBuf, curLen, cap, idx++);
-      traverse_impl(v, topicBuf, cap, curLen);
-      curLen = savedLen;
-      topicBuf[curLen] = '\0';
-    }
-    return;
-  }
-
-  // Primitive leaf -> publish
-  char payload[256];
-  const char* data = to_payload(node, payload, sizeof(payload));
-
-  // Ensure non-null topic string (can be empty if caller passed "")
-  publish(topicBuf, data);
-}
\ No newline at end of file
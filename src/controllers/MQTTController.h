@@ -13,11 +13,13 @@
 #ifndef YARR_MQTT_H
 #define YARR_MQTT_H
 
+#include "TopicWalker.h"
 #include "YarrboardConfig.h"
 #include "controllers/BaseController.h"
 #include "controllers/ProtocolController.h"
 #include <ArduinoJson.h>
 #include <PsychicMqttClient.h>
+#include <atomic>
 
 class YarrboardApp;
 class ConfigManager;
@@ -36,16 +38,26 @@ class MQTTController : public BaseController
 
     void onTopic(const char* topic, int qos, OnMessageUserCallback callback);
     void publish(const char* topic, const char* payload, bool use_prefix = true);
+    // publish every leaf of node as its own topic, see TopicWalker
     void traverseJSON(JsonVariant node, const char* topic_prefix);
 
-    void handleSetMQTTConfig(JsonVariantConst input, JsonVariant output, ProtocolContext context);
+    // publish a protocol response on the response topic
+    void sendResponse(JsonVariantConst output);
+
+    bool handleSetMQTTConfig(JsonVariantConst input, JsonVariant output, ProtocolContext context, ProtocolReply reply);
     void generateStatsHook(JsonVariant output) override;
 
   private:
     PsychicMqttClient mqttClient;
-    unsigned long previousMQTTMillis = 0;
     bool _firstConnection = true;
 
+    // set_mqtt_config answers once we know if the new settings work.
+    // only touched from our task group, onConnect() hands off through _connected
+    ProtocolReply _connectReply;
+    uint32_t _connectStarted = 0;
+    std::atomic<bool> _connected{false};
+    void finishConnectReply(const char* error);
+
     void haDiscovery();
     void receiveMessage(const char* topic, const char* payload, int retain, int qos, bool dup);
 
@@ -62,11 +74,6 @@ class MQTTController : public BaseController
     static void _onDisconnectStatic(bool sessionPresent);
     static void _onErrorStatic(esp_mqtt_error_codes_t error);
     static void _receiveMessageStatic(const char* topic, const char* payload, int retain, int qos, bool dup);
-
-    void append_to_topic(char* buf, size_t& len, size_t cap, const char* piece);
-    void append_index_to_topic(char* buf, size_t& len, size_t cap, size_t index);
-    const char* to_payload(JsonVariant v, char* out, size_t outcap);
-    void traverse_impl(JsonVariant node, char* topicBuf, size_t cap, size_t curLen);
 };
 
 #endif /* !YARR_MQTT_H */
\ No newline at end of file
@@ -17,6 +17,7 @@ NTPController* NTPController::_instance = nullptr;
 
 NTPController::NTPController(YarrboardApp& app) : BaseController(app, "ntp")
 {
+  _needs = YB_NEEDS_CONFIG | YB_NEEDS_WIFI;
 }
 
 bool NTPController::setup()
@@ -12,11 +12,13 @@
 
 #include "controllers/NavicoController.h"
 #include "ConfigManager.h"
+#include "JsonPool.h"
 #include "YarrboardDebug.h"
 
 NavicoController::NavicoController(YarrboardApp& app) : BaseController(app, "navico"),
                                                         MULTICAST_GROUP_IP(239, 2, 1, 1)
 {
+  _needs = YB_NEEDS_CONFIG | YB_NEEDS_WIFI;
 }
 
 // This code borrowed from the SignalK project:
@@ -38,7 +40,7 @@ void NavicoController::loop()
     url = urlBuf; // assign once
 
     // generate our config JSON
-    JsonDocument doc;
+    JsonDocument doc(&jsonPool);
 
     doc["Version"] = "1";
     doc["Source"] = _cfg.board_name;
@@ -63,7 +65,7 @@ void NavicoController::loop()
 
     // make our dynamic buffer for the output
     size_t jsonSize = measureJson(doc);
-    char* jsonBuffer = (char*)malloc(jsonSize + 1);
+    char* jsonBuffer = (char*)jsonPool.allocate(jsonSize + 1);
     if (!jsonBuffer) {
       YBP.println("Navico malloc failed!");
       return;
@@ -81,7 +83,7 @@ void NavicoController::loop()
       YBP.println("UDP beginPacket failed");
     }
 
-    free(jsonBuffer);
+    jsonPool.deallocate(jsonBuffer);
 
     lastNavicoPublishMillis = millis();
   }
@@ -21,6 +21,7 @@ NetworkController::NetworkController(YarrboardApp& app) : BaseController(app, "n
                                                           improvSerial(&Serial),
                                                           apIP(8, 8, 4, 4)
 {
+  _needs = YB_NEEDS_CONFIG;
 }
 
 bool NetworkController::setup()
@@ -33,6 +34,14 @@ bool NetworkController::setup()
   // pin 0 is boot pin
   pinMode(YB_BOOT_PIN, INPUT);
 
+  // the event task tells us when we're online, loop() does the rest
+  WiFi.onEvent(
+    [this](WiFiEvent_t event, WiFiEventInfo_t info) {
+      _gotIP = true;
+      signal();
+    },
+    ARDUINO_EVENT_WIFI_STA_GOT_IP);
+
   if (_cfg.is_first_boot)
     setupImprov();
   else
@@ -46,6 +55,46 @@ void NetworkController::loop()
   if (_cfg.is_first_boot) {
     improvSerial.handleSerial();
   }
+
+  // both of these are polled, a blocking wait here would stall the whole loop
+  if (_wifiConnecting)
+    checkWifi();
+  else if (_waitingForBootPress)
+    checkBootPress();
+}
+
+void NetworkController::checkWifi()
+{
+  if (_gotIP) {
+    _wifiConnecting = false;
+
+    YBP.println("[WiFi] WiFi is connected!");
+    YBP.print("[WiFi] IP address: ");
+    YBP.println(WiFi.localIP());
+
+    _app.setStatusColor(CRGB::Green);
+
+    startServices();
+    _wifiReady = true;
+    _app.recordBootEvent("wifi", _wifiStartMicros);
+
+    return;
+  }
+
+  if (WiFi.status() == WL_NO_SSID_AVAIL)
+    YBP.println("[WiFi] SSID not found");
+  else if (millis() - _wifiStartMillis < YB_WIFI_CONNECT_TIMEOUT_MS)
+    return;
+
+  _wifiConnecting = false;
+  _app.recordBootEvent("wifi", _wifiStartMicros, false);
+
+  YBP.println("[WiFi] WiFi failed to connect");
+  stopWifi();
+
+  // nothing else to do without wifi, loop() keeps an eye on the boot button
+  _waitingForBootPress = true;
+  _bootPressed = false;
 }
 
 void NetworkController::setupWifi()
@@ -57,11 +106,12 @@ void NetworkController::setupWifi()
     YBP.print(" / ");
     YBP.println(_cfg.wifi_pass);
 
-    // try and connect
-    if (connectToWifi(_cfg.wifi_ssid, _cfg.wifi_pass))
-      startServices();
-    else
-      waitForBootPress();
+    // start connecting, loop() picks it up from here
+    _gotIP = false;
+    _wifiConnecting = true;
+    _wifiStartMillis = millis();
+    _wifiStartMicros = esp_timer_get_time();
+    beginWifi(_cfg.wifi_ssid, _cfg.wifi_pass);
   }
   // default to AP mode.
   else {
@@ -83,40 +133,33 @@ void NetworkController::setupWifi()
   }
 }
 
-void NetworkController::waitForBootPress()
+void NetworkController::checkBootPress()
 {
-  unsigned long pressStartTime = 0;
-  bool buttonPressed = false;
-
-  while (true) {
-    // Read the boot pin (LOW when pressed)
-    if (digitalRead(YB_BOOT_PIN) == LOW) {
-      if (!buttonPressed) {
-        // Button just pressed, record the time
-        buttonPressed = true;
-        pressStartTime = millis();
-      } else {
-        // Button is being held, check if 5 seconds have elapsed
-        if (millis() - pressStartTime >= 5000) {
-          YBP.println("Boot button held for 5 seconds - resetting to first boot");
-          _cfg.is_first_boot = true;
-
-          char error[128];
-          _cfg.saveConfig(error, sizeof(error));
-          ESP.restart();
-        }
-      }
-    } else {
-      // Button released, reset the tracking
-      buttonPressed = false;
-    }
+  // Read the boot pin (LOW when pressed)
+  if (digitalRead(YB_BOOT_PIN) != LOW) {
+    _bootPressed = false;
+    return;
+  }
 
-    delay(100);
-    yield();
+  // Button just pressed, record the time
+  if (!_bootPressed) {
+    _bootPressed = true;
+    _bootPressStart = millis();
+    return;
+  }
+
+  // Button is being held, check if 5 seconds have elapsed
+  if (millis() - _bootPressStart >= 5000) {
+    YBP.println("Boot button held for 5 seconds - resetting to first boot");
+    _cfg.is_first_boot = true;
+
+    char error[128];
+    _cfg.saveConfig(error, sizeof(error));
+    ESP.restart();
   }
 }
 
-bool NetworkController::connectToWifi(const char* ssid, const char* pass)
+void NetworkController::beginWifi(const char* ssid, const char* pass)
 {
   _app.setStatusColor(CRGB::Yellow);
 
@@ -135,14 +178,46 @@ bool NetworkController::connectToWifi(const char* ssid, const char* pass)
   WiFi.setAutoReconnect(true);
   WiFi.setSleep(false); // optional but usually helps reliability
 
-  // How long to try for?
-  int tryDuration = 15000;
-  int tryDelay = 50;
-  int numberOfTries = tryDuration / tryDelay;
-
   YBP.print("[WiFi] Connecting to ");
   YBP.println(ssid);
   WiFi.begin(ssid, pass);
+}
+
+bool NetworkController::connectToWifi(const char* ssid, const char* pass)
+{
+  beginWifi(ssid, pass);
+
+  if (waitForWifi()) {
+    _app.setStatusColor(CRGB::Green);
+    return true;
+  }
+
+  stopWifi();
+  return false;
+}
+
+void NetworkController::tryWifi(const char* ssid, const char* pass)
+{
+  // whatever we were connecting to before, checkWifi() can stop watching it
+  _wifiConnecting = false;
+  _waitingForBootPress = false;
+
+  beginWifi(ssid, pass);
+}
+
+void NetworkController::restoreWifi()
+{
+  // back to whatever is in our config, loop() finishes connecting
+  stopWifi();
+  setupWifi();
+}
+
+bool NetworkController::waitForWifi()
+{
+  // How long to try for?
+  int tryDuration = YB_WIFI_CONNECT_TIMEOUT_MS;
+  int tryDelay = 50;
+  int numberOfTries = tryDuration / tryDelay;
 
   // attempt to connect
   while (numberOfTries > 0) {
@@ -151,8 +226,6 @@ bool NetworkController::connectToWifi(const char* ssid, const char* pass)
       YBP.print("[WiFi] IP address: ");
       YBP.println(WiFi.localIP());
 
-      _app.setStatusColor(CRGB::Green);
-
       return true;
     }
 
@@ -170,13 +243,17 @@ bool NetworkController::connectToWifi(const char* ssid, const char* pass)
   }
 
   YBP.println("\n[WiFi] WiFi failed to connect");
+
+  return false;
+}
+
+void NetworkController::stopWifi()
+{
   WiFi.setAutoReconnect(false); // Stop auto-reconnect attempts
   WiFi.disconnect(true, true);
   WiFi.mode(WIFI_OFF);
 
   _app.setStatusColor(CRGB::Red);
-
-  return false;
 }
 
 void NetworkController::startServices()
@@ -38,8 +38,19 @@ class NetworkController : public BaseController
 
     void setupWifi();
     bool connectToWifi(const char* ssid, const char* pass);
+    void beginWifi(const char* ssid, const char* pass);
     void startServices();
 
+    // Trying out new credentials, for set_network_config.  tryWifi() and
+    // restoreWifi() change our state so they belong on the main loop, the
+    // blocking waitForWifi() can run anywhere.
+    void tryWifi(const char* ssid, const char* pass);
+    bool waitForWifi();
+    void restoreWifi();
+
+    // true once our wifi client has an IP and services are started
+    bool isWifiReady() { return _wifiReady; }
+
     IPAddress apIP;
     bool improvDone = false;
 
@@ -60,7 +71,21 @@ class NetworkController : public BaseController
     // We use a static instance pointer and static methods to bridge the gap.
     static NetworkController* _instance;
 
-    void waitForBootPress();
+    // non-blocking connect from setup()
+    bool _wifiConnecting = false;
+    bool _wifiReady = false;
+    volatile bool _gotIP = false;
+    unsigned long _wifiStartMillis = 0;
+    int64_t _wifiStartMicros = 0;
+
+    // wifi failed, hold boot for 5s to go back to first boot setup
+    bool _waitingForBootPress = false;
+    bool _bootPressed = false;
+    unsigned long _bootPressStart = 0;
+
+    void checkWifi();
+    void checkBootPress();
+    void stopWifi();
 
     static void _onImprovErrorStatic(ImprovTypes::Error err);
     static void _onImprovConnectedStatic(const char* ssid, const char* password);
@@ -25,7 +25,7 @@ bool OTAController::setup()
 {
   _instance = this; // Capture the instance for callbacks
 
-  _app.protocol.registerCommand(ADMIN, "ota_start", this, &OTAController::handleOTAStart);
+  _app.protocol.registerAsyncCommand(ADMIN, "ota_start", this, &OTAController::handleOTAStart);
 
   if (_cfg.app_enable_ota) {
     ArduinoOTA.setHostname(_cfg.local_hostname);
@@ -60,22 +60,28 @@ bool OTAController::setup()
 
 void OTAController::loop()
 {
-  if (doOTAUpdate) {
+  if (doOTAUpdate.exchange(false))
     FOTA->handle();
-    doOTAUpdate = false;
-  }
 
   if (_cfg.app_enable_ota) {
     ArduinoOTA.handle();
   }
 }
 
-void OTAController::handleOTAStart(JsonVariantConst input, JsonVariant output, ProtocolContext context)
+bool OTAController::handleOTAStart(JsonVariantConst input, JsonVariant output, ProtocolContext context, ProtocolReply reply)
 {
-  if (_app.ota.checkOTA())
-    _app.ota.startOTA();
-  else
-    return _app.protocol.generateErrorJSON(output, "Firmware already up to date.");
+  // checking the manifest is an https request, so do it on the worker
+  bool started = _app.protocol.runAsync(reply, input, [this](JsonVariantConst input, JsonVariant output) {
+    if (checkOTA())
+      startOTA();
+    else
+      _app.protocol.generateErrorJSON(output, "Firmware already up to date.");
+  });
+
+  if (!started)
+    _app.protocol.generateErrorJSON(output, "Can't check for firmware updates right now, try again.");
+
+  return started;
 }
 
 void OTAController::end()
@@ -95,6 +101,7 @@ void OTAController::startOTA()
 {
   YBP.printf("Starting OTA.");
   doOTAUpdate = true;
+  signal();
 }
 
 void OTAController::_updateBeginFailCallback(int partition)
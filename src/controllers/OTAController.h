@@ -17,6 +17,7 @@
 #include "controllers/ProtocolController.h"
 #include "utility.h"
 #include <ArduinoOTA.h>
+#include <atomic>
 
 #define DISABLE_ALL_LIBRARY_WARNINGS
 #include <esp32FOTA.hpp>
@@ -45,7 +46,8 @@ class OTAController : public BaseController
       FOTA;
 
     CryptoMemAsset* MyPubKey;
-    bool doOTAUpdate = false;
+    // set from the async worker, picked up by loop()
+    std::atomic<bool> doOTAUpdate{false};
     unsigned long ota_last_message = 0;
 
     // --- THE CALLBACK TRAP ---
@@ -62,7 +64,7 @@ class OTAController : public BaseController
     void _updateEndCallback(int partition);
     void _updateCheckFailCallback(int partition, int error_code);
 
-    void handleOTAStart(JsonVariantConst input, JsonVariant output, ProtocolContext context);
+    bool handleOTAStart(JsonVariantConst input, JsonVariant output, ProtocolContext context, ProtocolReply reply);
     void sendOTAProgressUpdate(float progress);
     void sendOTAProgressFinished();
 };
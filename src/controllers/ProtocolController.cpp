@@ -14,15 +14,31 @@
 #include "ConfigManager.h"
 #include "YarrboardApp.h"
 #include "YarrboardDebug.h"
+#include "YarrboardTrace.h"
 #include "controllers/OTAController.h"
 #include "utility.h"
+#include <new>
 
 ProtocolController::ProtocolController(YarrboardApp& app) : BaseController(app, "protocol")
 {
+  _needs = YB_NEEDS_CONFIG;
 }
 
 bool ProtocolController::setup()
 {
+  subscriptionMutex = xSemaphoreCreateMutex();
+  pendingMutex = xSemaphoreCreateMutex();
+
+  if (!responseCache.begin()) {
+    YBP.println("❌ Failed to create response cache mutex");
+    return false;
+  }
+
+  // everybody asks for these when they connect
+  cacheCommand("get_config", YB_RESPONSE_CACHE_CONFIG_TTL_MS);
+  cacheCommand("get_app_config", YB_RESPONSE_CACHE_CONFIG_TTL_MS);
+  cacheCommand("get_network_config", YB_RESPONSE_CACHE_CONFIG_TTL_MS);
+  cacheCommand("get_update", YB_RESPONSE_CACHE_UPDATE_TTL_MS);
   registerCommand(NOBODY, "ping", this, &ProtocolController::handlePing);
   registerCommand(NOBODY, "hello", this, &ProtocolController::handleHello);
   registerCommand(NOBODY, "login", this, &ProtocolController::handleLogin);
@@ -31,6 +47,8 @@ bool ProtocolController::setup()
   registerCommand(GUEST, "get_config", this, &ProtocolController::handleGetConfig);
   registerCommand(GUEST, "get_stats", this, &ProtocolController::handleGetStats);
   registerCommand(GUEST, "get_update", this, &ProtocolController::handleGetUpdate);
+  registerCommand(GUEST, "subscribe", this, &ProtocolController::handleSubscribe);
+  registerCommand(GUEST, "unsubscribe", this, &ProtocolController::handleUnsubscribe);
   registerCommand(GUEST, "set_theme", this, &ProtocolController::handleSetTheme);
   registerCommand(GUEST, "set_brightness", this, &ProtocolController::handleSetBrightness);
 
@@ -39,7 +57,7 @@ bool ProtocolController::setup()
   registerCommand(ADMIN, "get_full_config", this, &ProtocolController::handleGetFullConfig);
   registerCommand(ADMIN, "get_network_config", this, &ProtocolController::handleGetNetworkConfig);
   registerCommand(ADMIN, "get_app_config", this, &ProtocolController::handleGetAppConfig);
-  registerCommand(ADMIN, "set_network_config", this, &ProtocolController::handleSetNetworkConfig);
+  registerAsyncCommand(ADMIN, "set_network_config", this, &ProtocolController::handleSetNetworkConfig);
   registerCommand(ADMIN, "set_authentication_config", this, &ProtocolController::handleSetAuthenticationConfig);
   registerCommand(ADMIN, "set_webserver_config", this, &ProtocolController::handleSetWebServerConfig);
   registerCommand(ADMIN, "set_misc_config", this, &ProtocolController::handleSetMiscellaneousConfig);
@@ -66,8 +84,8 @@ void ProtocolController::loop()
 
   // check to see if we need to send one.
   bool doFastUpdate = false;
-  for (const auto& entry : _app.getControllers()) {
-    if (entry.controller->needsFastUpdate()) {
+  for (BaseController* controller : _app.getHookControllers(YB_HOOK_FAST_UPDATE)) {
+    if (controller->needsFastUpdate()) {
       doFastUpdate = true;
       break;
     }
@@ -76,42 +94,192 @@ void ProtocolController::loop()
   if (doFastUpdate)
     sendFastUpdate();
 
+  // anything to push?
+  if (!subscriptions.empty())
+    runSubscriptions();
+
+  // async commands that never answered
+  if (!pendingReplies.empty())
+    expireReplies();
+
   // any serial port customers?
-  if (_cfg.app_enable_serial) {
-    if (Serial.available() > 0)
-      handleSerialJson();
-  }
+  if (_cfg.app_enable_serial)
+    serial.poll([this](SerialTransport::Channel channel, char* data, size_t len) { handleSerialMessage(channel, data, len); });
+  else
+    serial.flush();
+
+  // we only run every few ms, come right back if the port is busy
+  if (serial.hasWork(_cfg.app_enable_serial))
+    signal();
 }
 
 bool ProtocolController::registerCommand(UserRole role, const char* command, ProtocolMessageHandler handler)
 {
-  if (commandMap.full()) {
-    YBP.printf("❌ Error: Protocol command list is full. (%s)\n", command);
+  ProtocolCommand* entry = addCommand(role, command);
+  if (entry == nullptr)
     return false;
+
+  entry->handler = handler;
+  entry->invoke = &invokeHandler;
+  return true;
+}
+
+bool ProtocolController::registerAsyncCommand(UserRole role, const char* command, ProtocolAsyncHandler handler)
+{
+  ProtocolCommand* entry = addCommand(role, command);
+  if (entry == nullptr)
+    return false;
+
+  entry->asyncHandler = handler;
+  entry->invokeAsync = &invokeAsyncHandler;
+  return true;
+}
+
+ProtocolController::ProtocolCommand* ProtocolController::addCommand(UserRole role, const char* command)
+{
+  // re-registering keeps the same id
+  int16_t id = findCommand(command);
+  if (id >= 0) {
+    ProtocolCommand& entry = commands[id];
+    if (entry.active)
+      YBP.printf("⚠️ Warning: Overwriting protocol command '%s'\n", command);
+
+    entry.role = role;
+    entry.active = true;
+    entry.cache_ttl_ms = getCacheTTL(command);
+    entry.instance = nullptr;
+    entry.owner = nullptr;
+    entry.handler = nullptr;
+    entry.invoke = nullptr;
+    entry.asyncHandler = nullptr;
+    entry.invokeAsync = nullptr;
+    return &entry;
+  }
+
+  if (commands.full()) {
+    YBP.printf("❌ Error: Protocol command list is full. (%s)\n", command);
+    return nullptr;
+  }
+
+  ProtocolCommand entry = {};
+  entry.name = command;
+  entry.hash = hashCommand(command);
+  entry.role = role;
+  entry.active = true;
+  entry.cache_ttl_ms = getCacheTTL(command);
+  commands.push_back(entry);
+
+  // drop it in the first free slot
+  size_t slot = entry.hash & (COMMAND_SLOTS - 1);
+  while (commandSlots[slot])
+    slot = (slot + 1) & (COMMAND_SLOTS - 1);
+  commandSlots[slot] = commands.size();
+
+  return &commands.back();
+}
+
+int16_t ProtocolController::findCommand(const char* command)
+{
+  uint32_t hash = hashCommand(command);
+
+  // the table is never more than half full, so this always hits an empty slot
+  for (size_t slot = hash & (COMMAND_SLOTS - 1); commandSlots[slot]; slot = (slot + 1) & (COMMAND_SLOTS - 1)) {
+    const ProtocolCommand& entry = commands[commandSlots[slot] - 1];
+    if (entry.hash == hash && !strcmp(entry.name, command))
+      return commandSlots[slot] - 1;
+  }
+
+  return -1;
+}
+
+int16_t ProtocolController::getCommandId(const char* command)
+{
+  int16_t id = findCommand(command);
+  if (id >= 0 && commands[id].active)
+    return id;
+
+  return -1;
+}
+
+bool ProtocolController::cacheCommand(const char* command, uint32_t ttl_ms)
+{
+  // remember it for addCommand(), the command may not be registered yet
+  CacheTTL* entry = nullptr;
+  for (auto& ttl : cacheTTLs) {
+    if (!strcmp(ttl.name, command)) {
+      entry = &ttl;
+      break;
+    }
   }
 
-  if (hasCommand(command))
-    YBP.printf("⚠️ Warning: Overwriting protocol command '%s'\n", command);
+  if (!entry) {
+    if (cacheTTLs.full()) {
+      YBP.printf("❌ Error: Response cache list is full. (%s)\n", command);
+      return false;
+    }
+    cacheTTLs.push_back({command, ttl_ms});
+  } else
+    entry->ttl_ms = ttl_ms;
+
+  int16_t id = getCommandId(command);
+  if (id >= 0) {
+    commands[id].cache_ttl_ms = ttl_ms;
+    responseCache.invalidate(id);
+  }
 
-  commandMap[command] = {role, handler};
   return true;
 }
 
+uint32_t ProtocolController::getCacheTTL(const char* command)
+{
+  for (auto& ttl : cacheTTLs) {
+    if (!strcmp(ttl.name, command))
+      return ttl.ttl_ms;
+  }
+
+  return 0;
+}
+
+void ProtocolController::invalidateCache(const char* command)
+{
+  if (command == nullptr)
+    return responseCache.invalidate();
+
+  int16_t id = getCommandId(command);
+  if (id >= 0)
+    responseCache.invalidate(id);
+}
+
 bool ProtocolController::unregisterCommand(const char* command)
 {
-  return commandMap.erase(command) > 0;
+  int16_t id = getCommandId(command);
+  if (id < 0)
+    return false;
+
+  // leave it in the table so the other ids don't move
+  ProtocolCommand& entry = commands[id];
+  entry.active = false;
+  entry.instance = nullptr;
+  entry.owner = nullptr;
+  entry.handler = nullptr;
+  entry.invoke = nullptr;
+  entry.asyncHandler = nullptr;
+  entry.invokeAsync = nullptr;
+
+  return true;
 }
 
 bool ProtocolController::hasCommand(const char* command)
 {
-  return commandMap.find(command) != commandMap.end();
+  return getCommandId(command) >= 0;
 }
 
 void ProtocolController::printCommands()
 {
   YBP.println("Protocol Commands:");
-  for (const auto& kvp : commandMap)
-    YBP.printf("%-6s | %s\n", _app.auth.getRoleText(kvp.second.role), kvp.first);
+  for (size_t id = 0; id < commands.size(); id++)
+    if (commands[id].active)
+      YBP.printf("%-6s | %2d | %s\n", _app.auth.getRoleText(commands[id].role), id, commands[id].name);
 }
 
 void ProtocolController::incrementSentMessages()
@@ -121,20 +289,24 @@ void ProtocolController::incrementSentMessages()
   totalSentMessages++;
 }
 
-void ProtocolController::handleSerialJson()
+void ProtocolController::handleSerialMessage(SerialTransport::Channel channel, char* data, size_t len)
 {
-  JsonDocument input;
-  DeserializationError err = deserializeJson(input, Serial);
-  JsonDocument output;
+  JsonDocument input(&jsonPool);
+  DeserializationError err;
+  if (channel == SerialTransport::CHANNEL_MSGPACK)
+    err = deserializeMsgPack(input, data, len);
+  else
+    err = deserializeJson(input, data, len);
+
+  // broadcasts follow whatever the host talks to us in
+  serialChannel = channel;
 
-  // ignore newlines with serial.
+  JsonDocument output(&jsonPool);
   if (err) {
-    if (strcmp(err.c_str(), "EmptyInput")) {
-      char error[64];
-      sprintf(error, "deserializeJson() failed with code %s", err.c_str());
-      generateErrorJSON(output, error);
-      serializeJson(output, Serial);
-    }
+    char error[64];
+    sprintf(error, "deserialize failed with code %s", err.c_str());
+    generateErrorJSON(output, error);
+    sendSerial(output);
   } else {
     ProtocolContext context;
     context.mode = YBP_MODE_SERIAL;
@@ -142,7 +314,7 @@ void ProtocolController::handleSerialJson()
 
     // we can have empty responses
     if (output.size()) {
-      serializeJson(output, Serial);
+      sendSerial(output);
 
       sentMessages++;
       totalSentMessages++;
@@ -150,14 +322,94 @@ void ProtocolController::handleSerialJson()
   }
 }
 
+void ProtocolController::sendSerial(JsonVariantConst output)
+{
+  bool msgpack = serialChannel == SerialTransport::CHANNEL_MSGPACK;
+  size_t size = msgpack ? measureMsgPack(output) : measureJson(output);
+  char* buffer = (char*)jsonPool.allocate(size + 1);
+
+  if (buffer != NULL) {
+    if (msgpack)
+      serializeMsgPack(output, buffer, size);
+    else
+      serializeJson(output, buffer, size + 1);
+
+    serial.send(serialChannel, buffer, size);
+    jsonPool.deallocate(buffer);
+  } else
+    YBP.println("Error allocating in ProtocolController::sendSerial");
+}
+
 void ProtocolController::handleReceivedJSON(JsonVariantConst input, JsonVariant output, ProtocolContext context)
 {
-  // make sure its correct
-  if (!input["cmd"].is<String>())
-    return generateErrorJSON(output, "'cmd' is a required parameter.");
+  // a bare array of commands gets a bare array of results
+  if (input.is<JsonArrayConst>())
+    return handleBatch(input[0], input, output.to<JsonArray>(), context);
+
+  // or {"cmd":"batch","cmds":[...]} if you want a msgid on the whole thing
+  if (input["cmd"] == "batch") {
+    if (!input["cmds"].is<JsonArrayConst>())
+      return generateErrorJSON(output, "'cmds' must be an array.");
+
+    if (input["msgid"].is<unsigned int>()) {
+      unsigned int msgid = input["msgid"];
+      output["status"] = "ok";
+      output["msgid"] = msgid;
+    }
+
+    output["msg"] = "batch";
+    return handleBatch(input, input["cmds"], output["results"].to<JsonArray>(), context);
+  }
+
+  // what would you say you do around here?
+  context.role = _app.auth.getUserRole(input, context.mode, context.clientId);
+
+  runCommand(input, output, context);
+}
+
+bool ProtocolController::hasParameters(JsonVariantConst input)
+{
+  for (JsonPairConst kv : input.as<JsonObjectConst>()) {
+    if (kv.key() != "cmd" && kv.key() != "msgid" && kv.key() != "user" && kv.key() != "pass")
+      return true;
+  }
 
-  // what is your command?
-  const char* cmd = input["cmd"];
+  return false;
+}
+
+void ProtocolController::handleBatch(JsonVariantConst auth, JsonArrayConst cmds, JsonArray results, ProtocolContext context)
+{
+  if (cmds.size() > YB_PROTOCOL_MAX_BATCH) {
+    char error[64];
+    snprintf(error, sizeof(error), "Batch is limited to %d commands.", YB_PROTOCOL_MAX_BATCH);
+    return generateErrorJSON(results.add<JsonObject>(), error);
+  }
+
+  // one role for the whole batch, from the envelope or the first command
+  context.role = _app.auth.getUserRole(auth, context.mode, context.clientId);
+
+  // every command gets a slot, even if it has nothing to say, so results line up
+  for (JsonVariantConst cmd : cmds) {
+    JsonObject result = results.add<JsonObject>();
+    if (cmd.is<JsonObjectConst>() && cmd["cmd"] != "batch")
+      runCommand(cmd, result, context, true);
+    else
+      generateErrorJSON(result, "Batch entries must be single commands.");
+  }
+}
+
+void ProtocolController::runCommand(JsonVariantConst input, JsonVariant output, ProtocolContext context, bool inBatch)
+{
+  // what is your command? numeric ids from hello skip the hash lookup
+  int16_t id = -1;
+  if (input["cmd"].is<unsigned int>()) {
+    unsigned int cmdId = input["cmd"];
+    if (cmdId < commands.size())
+      id = cmdId;
+  } else if (input["cmd"].is<const char*>())
+    id = findCommand(input["cmd"]);
+  else
+    return generateErrorJSON(output, "'cmd' is a required parameter.");
 
   // let the client keep track of messages
   if (input["msgid"].is<unsigned int>()) {
@@ -170,46 +422,366 @@ void ProtocolController::handleReceivedJSON(JsonVariantConst input, JsonVariant
   receivedMessages++;
   totalReceivedMessages++;
 
-  // what would you say you do around here?
-  context.role = _app.auth.getUserRole(input, context.mode, context.clientId);
-
-  // Try to find the command in the new map system
-  auto it = commandMap.find(cmd);
-
-  // If FOUND, process it here and return.
-  // If NOT found, skip this block and let the legacy code handle it.
-  if (it != commandMap.end()) {
+  if (id >= 0 && commands[id].active) {
+    const ProtocolCommand& command = commands[id];
 
     // We found the command, so we must enforce auth.
-    if (!_app.auth.hasPermission(it->second.role, context.role)) {
-      String error = "Unauthorized for " + String(cmd);
+    if (!_app.auth.hasPermission(command.role, context.role)) {
+      String error = "Unauthorized for " + String(command.name);
       return generateErrorJSON(output, error.c_str());
     }
 
-    // Execute Handler
-    if (it->second.handler) {
-      it->second.handler(input, output, context);
+    // async commands answer later, through whatever transport asked
+    if (command.invokeAsync != nullptr) {
+      if (inBatch) {
+        String error = String(command.name) + " can't be used in a batch.";
+        return generateErrorJSON(output, error.c_str());
+      }
+
+      return runAsyncCommand(command, input, output, context);
+    }
+
+    // read-only and nothing that changes the answer? maybe we already have it.
+    if (command.cache_ttl_ms && !hasParameters(input)) {
+      if (responseCache.get(id, context.role, output))
+        return;
+
+      // generate it on its own, so the msgid doesn't end up in the cache
+      JsonDocument response(&jsonPool);
+      {
+        YB_TRACE_SCOPE(command.name);
+        invokeCommand(command, input, response, context);
+      }
+
+      if (response["msg"] != "status")
+        responseCache.put(id, context.role, response, command.cache_ttl_ms);
+
+      for (JsonPairConst kv : response.as<JsonObjectConst>())
+        output[kv.key()] = kv.value();
       return;
     }
+
+    // Execute Handler
+    YB_TRACE_SCOPE(command.name);
+    invokeCommand(command, input, output, context);
+    return;
   }
 
   // if we got here, no bueno.
-  String error = "Invalid command: " + String(cmd);
+  String error = "Invalid command: " + input["cmd"].as<String>();
   return generateErrorJSON(output, error.c_str());
 }
 
+void ProtocolController::invokeCommand(const ProtocolCommand& command, JsonVariantConst input, JsonVariant output, ProtocolContext context)
+{
+  if (command.owner == nullptr)
+    return command.invoke(command, input, output, context);
+
+  _app.runInGroup(command.owner->getGroup(), [&]() { command.invoke(command, input, output, context); });
+}
+
+bool ProtocolController::invokeAsyncCommand(const ProtocolCommand& command, JsonVariantConst input, JsonVariant output, ProtocolContext context, ProtocolReply reply)
+{
+  if (command.owner == nullptr)
+    return command.invokeAsync(command, input, output, context, reply);
+
+  bool deferred = false;
+  _app.runInGroup(command.owner->getGroup(), [&]() { deferred = command.invokeAsync(command, input, output, context, reply); });
+  return deferred;
+}
+
+void ProtocolController::runAsyncCommand(const ProtocolCommand& command, JsonVariantConst input, JsonVariant output, ProtocolContext context)
+{
+  PendingReply pending = {};
+  pending.mode = context.mode;
+  pending.clientId = context.clientId;
+  pending.hasMsgid = input["msgid"].is<unsigned int>();
+  pending.msgid = input["msgid"] | 0;
+  pending.started = millis();
+
+  // http has nowhere to send a late answer, so the request waits for it
+  if (context.mode == YBP_MODE_HTTP) {
+    pending.done = xSemaphoreCreateBinary();
+    pending.result = output;
+    if (pending.done == NULL)
+      return generateErrorJSON(output, "Error allocating async reply.");
+  }
+
+  ProtocolReply reply;
+  if (xSemaphoreTake(pendingMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+    if (!pendingReplies.full()) {
+      pending.id = nextReplyId++;
+      if (nextReplyId == 0)
+        nextReplyId = 1;
+
+      pendingReplies.push_back(pending);
+      reply.id = pending.id;
+    }
+    xSemaphoreGive(pendingMutex);
+  }
+
+  if (!reply.isValid()) {
+    if (pending.done != NULL)
+      vSemaphoreDelete(pending.done);
+    return generateErrorJSON(output, "Too many commands in progress, try again.");
+  }
+
+  bool deferred;
+  {
+    YB_TRACE_SCOPE(command.name);
+    deferred = invokeAsyncCommand(command, input, output, context, reply);
+  }
+
+  // answered right away, output is the response
+  if (!deferred) {
+    PendingReply unused;
+    takeReply(reply, unused);
+    if (pending.done != NULL)
+      vSemaphoreDelete(pending.done);
+    return;
+  }
+
+  // nothing to send now, complete() takes care of it
+  if (context.mode != YBP_MODE_HTTP) {
+    output.clear();
+    return;
+  }
+
+  // http has no way to answer later, so this holds the httpd task (and with
+  // it every websocket frame) until the reply comes in or times out.
+  if (xSemaphoreTake(pending.done, pdMS_TO_TICKS(YB_PROTOCOL_ASYNC_TIMEOUT_MS)) != pdTRUE) {
+    PendingReply unused;
+    if (takeReply(reply, unused)) {
+      asyncTimeouts++;
+      generateErrorJSON(output, "Timed out.");
+    }
+    // lost the race, complete() is filling in the answer right now
+    else
+      xSemaphoreTake(pending.done, portMAX_DELAY);
+  }
+
+  vSemaphoreDelete(pending.done);
+}
+
+bool ProtocolController::takeReply(ProtocolReply reply, PendingReply& pending)
+{
+  if (!reply.isValid() || pendingMutex == NULL)
+    return false;
+
+  bool found = false;
+  xSemaphoreTake(pendingMutex, portMAX_DELAY);
+  for (auto it = pendingReplies.begin(); it != pendingReplies.end(); ++it) {
+    if (it->id == reply.id) {
+      pending = *it;
+      pendingReplies.erase(it);
+      found = true;
+      break;
+    }
+  }
+  xSemaphoreGive(pendingMutex);
+
+  return found;
+}
+
+bool ProtocolController::complete(ProtocolReply reply, JsonVariantConst output)
+{
+  // whoever takes it out of the list gets to answer, so finishing twice is harmless
+  PendingReply pending;
+  if (!takeReply(reply, pending))
+    return false;
+
+  if (pending.mode == YBP_MODE_HTTP) {
+    for (JsonPairConst kv : output.as<JsonObjectConst>())
+      pending.result[kv.key()] = kv.value();
+    xSemaphoreGive(pending.done);
+  } else
+    sendReply(pending, output);
+
+  return true;
+}
+
+void ProtocolController::sendReply(const PendingReply& pending, JsonVariantConst output)
+{
+  // same shape as if the handler had answered right away
+  JsonDocument doc(&jsonPool);
+  if (pending.hasMsgid) {
+    doc["status"] = "ok";
+    doc["msgid"] = pending.msgid;
+  }
+
+  for (JsonPairConst kv : output.as<JsonObjectConst>())
+    doc[kv.key()] = kv.value();
+
+  // we can have empty responses
+  if (!doc.size())
+    return;
+
+  if (pending.mode == YBP_MODE_WEBSOCKET) {
+    int socket = pending.clientId;
+    _app.http.sendToWebsockets(doc, &socket, 1);
+  } else if (pending.mode == YBP_MODE_SERIAL)
+    sendSerial(doc);
+  else if (pending.mode == YBP_MODE_MQTT)
+    _app.mqtt.sendResponse(doc);
+  else
+    return;
+
+  sentMessages++;
+  totalSentMessages++;
+}
+
+bool ProtocolController::runAsync(ProtocolReply reply, JsonVariantConst input, ProtocolAsyncWork work)
+{
+  if (!reply.isValid() || pendingMutex == NULL)
+    return false;
+
+  // most boards never need it, so only pay for the stack once something does
+  xSemaphoreTake(pendingMutex, portMAX_DELAY);
+  if (workerTask == NULL) {
+    if (workerQueue == NULL)
+      workerQueue = xQueueCreate(YB_PROTOCOL_MAX_PENDING, sizeof(AsyncJob*));
+
+    if (workerQueue != NULL && xTaskCreate(workerLoop, "yb_async", YB_PROTOCOL_WORKER_STACK_SIZE, this, YB_PROTOCOL_WORKER_PRIORITY, &workerTask) != pdPASS)
+      workerTask = NULL;
+  }
+  xSemaphoreGive(pendingMutex);
+
+  if (workerTask == NULL) {
+    YBP.println("❌ Failed to start async worker task");
+    return false;
+  }
+
+  AsyncJob* job = new (std::nothrow) AsyncJob();
+  if (job == nullptr)
+    return false;
+
+  job->reply = reply;
+  job->input.set(input);
+  job->work = work;
+
+  if (xQueueSend(workerQueue, &job, 0) != pdTRUE) {
+    delete job;
+    return false;
+  }
+
+  return true;
+}
+
+void ProtocolController::workerLoop(void* arg)
+{
+  ProtocolController* self = static_cast<ProtocolController*>(arg);
+  AsyncJob* job;
+
+  while (true) {
+    if (xQueueReceive(self->workerQueue, &job, portMAX_DELAY) != pdTRUE)
+      continue;
+
+    JsonDocument output(&jsonPool);
+    job->work(job->input, output);
+    self->complete(job->reply, output);
+    delete job;
+
+    // the work may have left something for our controllers
+    self->_app.wake();
+  }
+}
+
+void ProtocolController::cancelReplies(int socket)
+{
+  if (pendingMutex == NULL)
+    return;
+
+  xSemaphoreTake(pendingMutex, portMAX_DELAY);
+  for (auto it = pendingReplies.begin(); it != pendingReplies.end();) {
+    if (it->mode == YBP_MODE_WEBSOCKET && it->clientId == (uint32_t)socket)
+      it = pendingReplies.erase(it);
+    else
+      ++it;
+  }
+  xSemaphoreGive(pendingMutex);
+}
+
+void ProtocolController::expireReplies()
+{
+  etl::vector<PendingReply, YB_PROTOCOL_MAX_PENDING> expired;
+
+  // http requests keep their own time
+  uint32_t now = millis();
+  xSemaphoreTake(pendingMutex, portMAX_DELAY);
+  for (auto it = pendingReplies.begin(); it != pendingReplies.end();) {
+    if (it->mode != YBP_MODE_HTTP && now - it->started >= YB_PROTOCOL_ASYNC_TIMEOUT_MS) {
+      expired.push_back(*it);
+      it = pendingReplies.erase(it);
+    } else
+      ++it;
+  }
+  xSemaphoreGive(pendingMutex);
+
+  for (const PendingReply& pending : expired) {
+    asyncTimeouts++;
+
+    JsonDocument output(&jsonPool);
+    generateErrorJSON(output, "Timed out.");
+    sendReply(pending, output);
+  }
+}
+
 void ProtocolController::handleHello(JsonVariantConst input, JsonVariant output, ProtocolContext context)
 {
+  // websocket clients can switch to binary msgpack frames
+  ClientEncoding encoding = YB_ENCODING_JSON;
+  if (context.mode == YBP_MODE_WEBSOCKET)
+    encoding = _app.auth.getClientEncoding(context.clientId);
+
+  if (input["encoding"].is<const char*>()) {
+    const char* requested = input["encoding"];
+    if (!strcmp(requested, "json"))
+      encoding = YB_ENCODING_JSON;
+    else if (!strcmp(requested, "msgpack"))
+      encoding = YB_ENCODING_MSGPACK;
+    else
+      return generateErrorJSON(output, "Unknown encoding.");
+
+    if (context.mode != YBP_MODE_WEBSOCKET && encoding != YB_ENCODING_JSON)
+      return generateErrorJSON(output, "msgpack is only supported over websocket.");
+
+    if (context.mode == YBP_MODE_WEBSOCKET && !_app.auth.setClientEncoding(context.clientId, encoding))
+      return generateErrorJSON(output, "Too many msgpack clients.");
+  }
+
   output["msg"] = "hello";
+  output["encoding"] = encoding == YB_ENCODING_MSGPACK ? "msgpack" : "json";
   output["role"] = _app.auth.getRoleText(context.role);
   output["default_role"] = _app.auth.getRoleText(_cfg.app_default_role);
   output["name"] = _cfg.board_name;
   output["brightness"] = _cfg.globalBrightness;
   output["firmware_version"] = _app.firmware_version;
+
+  // clients holding a config with this etag can skip get_config
+  char etag[ConfigManager::ETAG_LENGTH];
+  output["config_etag"] = _cfg.getETag(etag, sizeof(etag));
+
+  // clients can send these ids as "cmd" instead of the names
+  JsonObject ids = output["commands"].to<JsonObject>();
+  for (size_t id = 0; id < commands.size(); id++)
+    if (commands[id].active)
+      ids[commands[id].name] = id;
 }
 
 void ProtocolController::handleGetConfig(JsonVariantConst input, JsonVariant output, ProtocolContext context)
 {
+  // nothing changed since they last asked?
+  char etag[ConfigManager::ETAG_LENGTH];
+  _cfg.getETag(etag, sizeof(etag));
+
+  const char* match = input["if_none_match"];
+  if (match && !strcmp(match, etag)) {
+    output["msg"] = "config";
+    output["not_modified"] = true;
+    output["config_etag"] = etag;
+    return;
+  }
+
   generateConfigMessage(output);
 }
 
@@ -224,7 +796,25 @@ void ProtocolController::handleGetStats(JsonVariantConst input, JsonVariant outp
   output["sent_message_mps"] = sentMessagesPerSecond;
   output["websocket_client_count"] = _app.http.websocketClientCount;
   output["http_client_count"] = _app.http.httpClientCount - _app.http.websocketClientCount;
+  output["websocket_dropped_total"] = _app.http.websocketDropped;
+  output["websocket_throttle_total"] = _app.http.websocketThrottled;
+  output["websocket_queue_depth"] = _app.http.websocketQueueDepth();
+  output["response_cache_hits"] = responseCache.hits;
+  output["response_cache_misses"] = responseCache.misses;
+  output["serial_rx_overflow_total"] = serial.rxOverflows;
+  output["serial_rx_bad_frames_total"] = serial.rxBadFrames;
+  output["serial_tx_dropped_total"] = serial.txDropped;
+  output["serial_tx_queued"] = serial.txQueued();
+  output["json_pool_hits"] = jsonPool.hits;
+  output["json_pool_misses"] = jsonPool.misses;
+  output["json_pool_used"] = jsonPool.used();
+  output["json_pool_peak"] = jsonPool.peak();
+  output["async_pending"] = pendingReplies.size();
+  output["async_timeouts_total"] = asyncTimeouts;
   output["fps"] = (int)_app.framerate;
+  output["busy_percent"] = _app.busy_percent;
+  output["idle_percent"] = 100 - _app.busy_percent;
+  _app.generateTaskGroupStats(output["task_groups"]);
   output["uptime"] = esp_timer_get_time();
   output["heap_size"] = ESP.getHeapSize();
   output["free_heap"] = ESP.getFreeHeap();
@@ -238,19 +828,260 @@ void ProtocolController::handleGetStats(JsonVariantConst input, JsonVariant outp
   else
     output["ip_address"] = WiFi.localIP();
 
-  for (const auto& entry : _app.getControllers()) {
-    entry.controller->generateStatsHook(output);
-  }
+  _app.forEachHook(YB_HOOK_STATS, [&](BaseController* controller) {
+    controller->generateStatsHook(output);
+  });
 }
 
 void ProtocolController::handleGetUpdate(JsonVariantConst input, JsonVariant output, ProtocolContext context)
+{
+  if (!input["delta"].as<bool>())
+    return generateUpdateMessage(output);
+
+  // only send what changed since the last seq this client saw
+  JsonDocument update(&jsonPool);
+  generateUpdateMessage(update);
+  updateDelta.generate(context.mode, context.clientId, input["seq"] | 0, update, output);
+}
+
+void ProtocolController::handleSubscribe(JsonVariantConst input, JsonVariant output, ProtocolContext context)
+{
+  if (context.mode != YBP_MODE_WEBSOCKET)
+    return generateErrorJSON(output, "Subscriptions are only supported over websocket.");
+
+  uint32_t rate = input["rate"] | _cfg.app_update_interval;
+  rate = max((uint32_t)YB_SUBSCRIBE_MIN_RATE_MS, rate);
+
+  // "topics":["update","stats:pwm"] or just "topics":"update"
+  if (!input["topics"].is<JsonArrayConst>() && !input["topics"].is<const char*>())
+    return generateErrorJSON(output, "'topics' is a required parameter.");
+
+  // check them all before we change anything
+  YBHook topic[YB_MAX_SUBSCRIPTIONS];
+  BaseController* controller[YB_MAX_SUBSCRIPTIONS];
+  size_t count = 0;
+
+  auto addTopic = [&](const char* name) -> bool {
+    if (count >= YB_MAX_SUBSCRIPTIONS)
+      return false;
+    if (!parseTopic(name, topic[count], controller[count]))
+      return false;
+    count++;
+    return true;
+  };
+
+  char error[64];
+  if (input["topics"].is<const char*>()) {
+    if (!addTopic(input["topics"])) {
+      snprintf(error, sizeof(error), "Unknown topic: %s", input["topics"].as<const char*>());
+      return generateErrorJSON(output, error);
+    }
+  } else {
+    for (JsonVariantConst name : input["topics"].as<JsonArrayConst>()) {
+      if (!addTopic(name | "")) {
+        snprintf(error, sizeof(error), "Unknown topic: %s", name | "");
+        return generateErrorJSON(output, error);
+      }
+    }
+  }
+
+  if (xSemaphoreTake(subscriptionMutex, pdMS_TO_TICKS(100)) != pdTRUE)
+    return generateErrorJSON(output, "Subscriptions are busy, try again.");
+
+  int socket = context.clientId;
+  for (size_t i = 0; i < count; i++) {
+    // changing rates moves you to a different feed
+    removeSubscriber(socket, topic[i], controller[i]);
+
+    Subscription* feed = nullptr;
+    for (auto& sub : subscriptions) {
+      if (sub.topic == topic[i] && sub.controller == controller[i] && sub.rate_ms == rate) {
+        feed = &sub;
+        break;
+      }
+    }
+
+    if (!feed) {
+      if (subscriptions.full()) {
+        xSemaphoreGive(subscriptionMutex);
+        return generateErrorJSON(output, "Too many subscriptions.");
+      }
+
+      // first push on the next pass
+      subscriptions.push_back({topic[i], controller[i], rate, (uint32_t)(millis() - rate), {}});
+      feed = &subscriptions.back();
+    }
+
+    if (feed->sockets.full()) {
+      xSemaphoreGive(subscriptionMutex);
+      return generateErrorJSON(output, "Too many subscribers.");
+    }
+
+    feed->sockets.push_back(socket);
+  }
+
+  xSemaphoreGive(subscriptionMutex);
+
+  output["msg"] = "subscribe";
+  output["topics"] = input["topics"];
+  output["rate"] = rate;
+}
+
+void ProtocolController::handleUnsubscribe(JsonVariantConst input, JsonVariant output, ProtocolContext context)
+{
+  if (context.mode != YBP_MODE_WEBSOCKET)
+    return generateErrorJSON(output, "Subscriptions are only supported over websocket.");
+
+  // no topics = everything
+  if (input["topics"].isNull()) {
+    unsubscribeAll(context.clientId);
+  } else {
+    if (xSemaphoreTake(subscriptionMutex, pdMS_TO_TICKS(100)) != pdTRUE)
+      return generateErrorJSON(output, "Subscriptions are busy, try again.");
+
+    YBHook topic;
+    BaseController* controller;
+    if (input["topics"].is<const char*>()) {
+      if (parseTopic(input["topics"], topic, controller))
+        removeSubscriber(context.clientId, topic, controller);
+    } else {
+      for (JsonVariantConst name : input["topics"].as<JsonArrayConst>())
+        if (parseTopic(name | "", topic, controller))
+          removeSubscriber(context.clientId, topic, controller);
+    }
+
+    xSemaphoreGive(subscriptionMutex);
+  }
+
+  output["msg"] = "unsubscribe";
+  output["topics"] = input["topics"];
+}
+
+void ProtocolController::unsubscribeAll(int socket)
+{
+  if (subscriptionMutex == NULL)
+    return;
+
+  if (xSemaphoreTake(subscriptionMutex, pdMS_TO_TICKS(100)) != pdTRUE)
+    return;
+
+  removeSubscriber(socket, YB_HOOK_COUNT, nullptr);
+
+  xSemaphoreGive(subscriptionMutex);
+}
+
+bool ProtocolController::parseTopic(const char* name, YBHook& topic, BaseController*& controller)
+{
+  // "update", "stats", or "update:<controller>" for just one controller
+  const char* colon = strchr(name, ':');
+  size_t len = colon ? colon - name : strlen(name);
+
+  if (len == 6 && !strncmp(name, "update", len))
+    topic = YB_HOOK_UPDATE;
+  else if (len == 5 && !strncmp(name, "stats", len))
+    topic = YB_HOOK_STATS;
+  else
+    return false;
+
+  controller = nullptr;
+  if (colon) {
+    controller = _app.getController(colon + 1);
+    if (!controller)
+      return false;
+  }
+
+  return true;
+}
+
+// topic = YB_HOOK_COUNT removes the socket from everything, call with the mutex held
+void ProtocolController::removeSubscriber(int socket, YBHook topic, BaseController* controller)
+{
+  for (size_t i = 0; i < subscriptions.size();) {
+    Subscription& sub = subscriptions[i];
+
+    if (topic == YB_HOOK_COUNT || (sub.topic == topic && sub.controller == controller)) {
+      for (auto it = sub.sockets.begin(); it != sub.sockets.end(); ++it) {
+        if (*it == socket) {
+          sub.sockets.erase(it);
+          break;
+        }
+      }
+    }
+
+    // nobody left listening
+    if (sub.sockets.empty())
+      subscriptions.erase(subscriptions.begin() + i);
+    else
+      i++;
+  }
+}
+
+void ProtocolController::runSubscriptions()
+{
+  // busy? catch it next pass
+  if (xSemaphoreTake(subscriptionMutex, 0) != pdTRUE)
+    return;
+
+  uint32_t now = millis();
+  for (auto& sub : subscriptions) {
+    if (now - sub.lastRun < sub.rate_ms)
+      continue;
+
+    // no catch-up bursts if we fell behind
+    sub.lastRun += sub.rate_ms;
+    if (now - sub.lastRun >= sub.rate_ms)
+      sub.lastRun = now;
+
+    // roles can change after subscribing
+    etl::vector<int, YB_CLIENT_LIMIT> allowed;
+    for (int socket : sub.sockets) {
+      UserRole role = _app.auth.getUserRole(JsonVariantConst(), YBP_MODE_WEBSOCKET, socket);
+      if (_app.auth.hasPermission(GUEST, role))
+        allowed.push_back(socket);
+    }
+
+    if (allowed.empty())
+      continue;
+
+    // generated and serialized once, no matter how many are listening
+    JsonDocument output(&jsonPool);
+    generateTopic(sub, output);
+    _app.http.sendToWebsockets(output, allowed.data(), allowed.size());
+  }
+
+  xSemaphoreGive(subscriptionMutex);
+}
+
+void ProtocolController::generateTopic(const Subscription& sub, JsonVariant output)
+{
+  if (sub.topic == YB_HOOK_STATS) {
+    if (!sub.controller) {
+      ProtocolContext context;
+      handleGetStats(JsonVariantConst(), output, context);
+    } else {
+      output["msg"] = "stats";
+      output["uptime"] = esp_timer_get_time();
+      _app.runInGroup(sub.controller->getGroup(), [&]() { sub.controller->generateStatsHook(output); });
+    }
+  } else {
+    if (!sub.controller)
+      generateUpdateMessage(output);
+    else {
+      output["msg"] = "update";
+      output["uptime"] = esp_timer_get_time();
+      _app.runInGroup(sub.controller->getGroup(), [&]() { sub.controller->generateUpdateHook(output); });
+    }
+  }
+}
+
+void ProtocolController::generateUpdateMessage(JsonVariant output)
 {
   output["msg"] = "update";
   output["uptime"] = esp_timer_get_time();
 
-  for (const auto& entry : _app.getControllers()) {
-    entry.controller->generateUpdateHook(output);
-  }
+  _app.forEachHook(YB_HOOK_UPDATE, [&](BaseController* controller) {
+    controller->generateUpdateHook(output);
+  });
 }
 
 void ProtocolController::handleGetFullConfig(JsonVariantConst input, JsonVariant output, ProtocolContext context)
@@ -300,37 +1131,41 @@ void ProtocolController::handleSetGeneralConfig(JsonVariantConst input, JsonVari
   generateConfigMessage(output);
 }
 
-void ProtocolController::handleSetNetworkConfig(JsonVariantConst input, JsonVariant output, ProtocolContext context)
+bool ProtocolController::handleSetNetworkConfig(JsonVariantConst input, JsonVariant output, ProtocolContext context, ProtocolReply reply)
 {
   // clear our first boot flag since they submitted the network page.
   _cfg.is_first_boot = false;
 
   char error[128];
+  auto fail = [&](const char* message) {
+    generateErrorJSON(output, message);
+    return false;
+  };
 
   // error checking
   if (!input["wifi_mode"].is<String>())
-    return generateErrorJSON(output, "'wifi_mode' is a required parameter");
+    return fail("'wifi_mode' is a required parameter");
   if (!input["wifi_ssid"].is<String>())
-    return generateErrorJSON(output, "'wifi_ssid' is a required parameter");
+    return fail("'wifi_ssid' is a required parameter");
   if (!input["wifi_pass"].is<String>())
-    return generateErrorJSON(output, "'wifi_pass' is a required parameter");
+    return fail("'wifi_pass' is a required parameter");
   if (!input["local_hostname"].is<String>())
-    return generateErrorJSON(output, "'local_hostname' is a required parameter");
+    return fail("'local_hostname' is a required parameter");
 
   // is it too long?
   if (strlen(input["wifi_ssid"]) > YB_WIFI_SSID_LENGTH - 1) {
     sprintf(error, "Maximum wifi ssid length is %s characters.", YB_WIFI_SSID_LENGTH - 1);
-    return generateErrorJSON(output, error);
+    return fail(error);
   }
 
   if (strlen(input["wifi_pass"]) > YB_WIFI_PASSWORD_LENGTH - 1) {
     sprintf(error, "Maximum wifi password length is %s characters.", YB_WIFI_PASSWORD_LENGTH - 1);
-    return generateErrorJSON(output, error);
+    return fail(error);
   }
 
   if (strlen(input["local_hostname"]) > YB_HOSTNAME_LENGTH - 1) {
     sprintf(error, "Maximum hostname length is %s characters.", YB_HOSTNAME_LENGTH - 1);
-    return generateErrorJSON(output, error);
+    return fail(error);
   }
 
   // get our data
@@ -347,32 +1182,51 @@ void ProtocolController::handleSetNetworkConfig(JsonVariantConst input, JsonVari
   if (!strcmp(new_wifi_mode, "client")) {
     // did we change username/password?
     if (strcmp(new_wifi_ssid, _cfg.wifi_ssid) || strcmp(new_wifi_pass, _cfg.wifi_pass)) {
-      // try connecting.
-      YBP.printf("Trying new wifi %s / %s\n", new_wifi_ssid, new_wifi_pass);
-      if (_app.network.connectToWifi(new_wifi_ssid, new_wifi_pass)) {
-        // changing modes?
-        if (!strcmp(_cfg.wifi_mode, "ap"))
-          WiFi.softAPdisconnect();
-
-        // save for local use
-        strlcpy(_cfg.wifi_mode, new_wifi_mode, sizeof(_cfg.wifi_mode));
-        strlcpy(_cfg.wifi_ssid, new_wifi_ssid, sizeof(_cfg.wifi_ssid));
-        strlcpy(_cfg.wifi_pass, new_wifi_pass, sizeof(_cfg.wifi_pass));
-
-        // save it to file.
-        if (!_cfg.saveConfig(error, sizeof(error)))
-          return generateErrorJSON(output, error);
-      }
-      // nope, setup our wifi back to default.
-      else {
-        _app.network.connectToWifi(_cfg.wifi_ssid, _cfg.wifi_pass); // go back to our old wifi.
-        _app.network.startServices();
-        return generateErrorJSON(output, "Can't connect to new WiFi.");
-      }
+      // connecting takes a while, so answer once we know how it went
+      bool started = runAsync(reply, input, [this](JsonVariantConst input, JsonVariant output) {
+        const char* new_wifi_ssid = input["wifi_ssid"];
+        const char* new_wifi_pass = input["wifi_pass"];
+
+        // only the waiting happens out here, wifi changes go through the network
+        // controller's task and config changes through ours, like any other handler
+        YBP.printf("Trying new wifi %s / %s\n", new_wifi_ssid, new_wifi_pass);
+        uint8_t networkGroup = _app.network.getGroup();
+        _app.runInGroup(networkGroup, [&]() { _app.network.tryWifi(new_wifi_ssid, new_wifi_pass); });
+
+        bool connected = _app.network.waitForWifi();
+
+        // nope, setup our wifi back to default.
+        if (!connected) {
+          _app.runInGroup(networkGroup, [&]() { _app.network.restoreWifi(); });
+          return generateErrorJSON(output, "Can't connect to new WiFi.");
+        }
+
+        _app.runInGroup(networkGroup, [&]() {
+          _app.setStatusColor(CRGB::Green);
+
+          // changing modes?
+          if (!strcmp(_cfg.wifi_mode, "ap"))
+            WiFi.softAPdisconnect();
+        });
+
+        _app.runInGroup(getGroup(), [&]() {
+          // save for local use
+          strlcpy(_cfg.wifi_mode, "client", sizeof(_cfg.wifi_mode));
+          strlcpy(_cfg.wifi_ssid, new_wifi_ssid, sizeof(_cfg.wifi_ssid));
+          strlcpy(_cfg.wifi_pass, new_wifi_pass, sizeof(_cfg.wifi_pass));
+
+          // save it to file.
+          char error[128];
+          if (!_cfg.saveConfig(error, sizeof(error)))
+            return generateErrorJSON(output, error);
+        });
+      });
+
+      return started || fail("Can't start WiFi connection, try again.");
     } else {
       // save it to file.
       if (!_cfg.saveConfig(error, sizeof(error)))
-        return generateErrorJSON(output, error);
+        return fail(error);
     }
   }
   // okay, AP mode is easier
@@ -386,10 +1240,12 @@ void ProtocolController::handleSetNetworkConfig(JsonVariantConst input, JsonVari
     _app.network.setupWifi();
 
     if (!_cfg.saveConfig(error, sizeof(error)))
-      return generateErrorJSON(output, error);
+      return fail(error);
 
-    return generateSuccessJSON(output, "AP mode successful, please connect to new network.");
+    generateSuccessJSON(output, "AP mode successful, please connect to new network.");
   }
+
+  return false;
 }
 
 void ProtocolController::handleSetAuthenticationConfig(JsonVariantConst input, JsonVariant output, ProtocolContext context)
@@ -617,6 +1473,7 @@ void ProtocolController::handleSetTheme(JsonVariantConst input, JsonVariant outp
       "'theme' must either be 'light' or 'dark'");
 
   _cfg.app_theme = temp;
+  _cfg.markChanged();
 
   sendThemeUpdate();
 }
@@ -632,14 +1489,11 @@ void ProtocolController::handleSetBrightness(JsonVariantConst input, JsonVariant
     else if (brightness > 1)
       return generateErrorJSON(output, "Brightness must be <= 1");
 
-    _cfg.globalBrightness = brightness;
-
     // TODO: need to put this on a time delay
     // preferences.putFloat("brightness", globalBrightness);
 
-    for (const auto& entry : _app.getControllers()) {
-      entry.controller->updateBrightnessHook(brightness);
-    }
+    // controllers may live in other task groups, let them pick it up.
+    _app.updateBrightness(brightness);
     sendBrightnessUpdate();
   } else
     return generateErrorJSON(output, "'brightness' is a required parameter.");
@@ -649,6 +1503,9 @@ void ProtocolController::generateConfigMessage(JsonVariant output)
 {
   // extra info
   output["msg"] = "config";
+
+  char etag[ConfigManager::ETAG_LENGTH];
+  output["config_etag"] = _cfg.getETag(etag, sizeof(etag));
   output["hostname"] = _cfg.local_hostname;
   output["use_ssl"] = _cfg.app_enable_ssl;
   output["enable_ota"] = _cfg.app_enable_ota;
@@ -668,6 +1525,7 @@ void ProtocolController::generateConfigMessage(JsonVariant output)
   if (_app.debug.hasCoredump())
     output["has_coredump"] = _app.debug.hasCoredump();
   output["boot_log"] = startupLogger.c_str();
+  _app.generateBootTimeline(output["boot_timeline"]);
 
   // do we want to flag it for config?
   if (_cfg.is_first_boot)
@@ -695,7 +1553,7 @@ void ProtocolController::handlePing(JsonVariantConst input, JsonVariant output,
 
 void ProtocolController::sendThemeUpdate()
 {
-  JsonDocument output;
+  JsonDocument output(&jsonPool);
   output["msg"] = "set_theme";
   output["theme"] = _cfg.app_theme;
 
@@ -704,7 +1562,7 @@ void ProtocolController::sendThemeUpdate()
 
 void ProtocolController::sendBrightnessUpdate()
 {
-  JsonDocument output;
+  JsonDocument output(&jsonPool);
   output["msg"] = "set_brightness";
   output["brightness"] = _cfg.globalBrightness;
 
@@ -713,22 +1571,22 @@ void ProtocolController::sendBrightnessUpdate()
 
 void ProtocolController::sendFastUpdate()
 {
-  JsonDocument output;
+  JsonDocument output(&jsonPool);
 
   output["msg"] = "update";
   output["fast"] = 1;
   output["uptime"] = esp_timer_get_time();
 
-  for (const auto& entry : _app.getControllers()) {
-    entry.controller->generateFastUpdateHook(output);
-  }
+  _app.forEachHook(YB_HOOK_FAST_UPDATE, [&](BaseController* controller) {
+    controller->generateFastUpdateHook(output);
+  });
 
   sendToAll(output, GUEST);
 }
 
 void ProtocolController::sendDebug(const char* message)
 {
-  JsonDocument output;
+  JsonDocument output(&jsonPool);
   output["debug"] = message;
 
   sendToAll(output, NOBODY);
@@ -738,24 +1596,36 @@ void ProtocolController::sendToAll(JsonVariantConst output, UserRole auth_level)
 {
   // dynamically allocate our buffer
   size_t jsonSize = measureJson(output);
-  char* jsonBuffer = (char*)malloc(jsonSize + 1);
+  char* jsonBuffer = (char*)jsonPool.allocate(jsonSize + 1);
 
   // did we get anything?
   if (jsonBuffer != NULL) {
     jsonBuffer[jsonSize] = '\0'; // null terminate
-    serializeJson(output, jsonBuffer, jsonSize + 1);
-    sendToAll(jsonBuffer, auth_level);
-    free(jsonBuffer);
+    {
+      YB_TRACE_SCOPE("json.serialize");
+      serializeJson(output, jsonBuffer, jsonSize + 1);
+    }
+    sendToAll(jsonBuffer, auth_level, output);
+    jsonPool.deallocate(jsonBuffer);
   } else {
     // dont call YBP b/c loops...
-    Serial.println("Error allocating in ProtocolController::sendToAll");
+    YBP.println("Error allocating in ProtocolController::sendToAll");
   }
 }
 
-void ProtocolController::sendToAll(const char* jsonString, UserRole auth_level)
+void ProtocolController::sendToAll(const char* jsonString, UserRole auth_level, JsonVariantConst output)
 {
-  _app.http.sendToAllWebsockets(jsonString, auth_level);
-
-  if (_cfg.app_enable_serial && _cfg.serial_role >= auth_level)
-    Serial.println(jsonString);
+  _app.http.sendToAllWebsockets(jsonString, auth_level, output);
+
+  if (_cfg.app_enable_serial && _cfg.serial_role >= auth_level) {
+    if (serialChannel == SerialTransport::CHANNEL_JSON)
+      serial.send(jsonString);
+    else if (!output.isNull())
+      sendSerial(output);
+    else {
+      JsonDocument doc(&jsonPool);
+      deserializeJson(doc, jsonString);
+      sendSerial(doc);
+    }
+  }
 }
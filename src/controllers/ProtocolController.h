@@ -13,6 +13,10 @@
 #ifndef YARR_PROTOCOL_H
 #define YARR_PROTOCOL_H
 
+#include "JsonPool.h"
+#include "ResponseCache.h"
+#include "SerialTransport.h"
+#include "UpdateDelta.h"
 #include "YarrboardConfig.h"
 #include "controllers/AuthController.h"
 #include "controllers/BaseController.h"
@@ -21,7 +25,7 @@
 #include <ArduinoJson.h>
 #include <PsychicHttp.h>
 #include <cstring>
-#include <etl/map.h>
+#include <etl/vector.h>
 #include <functional>
 
 typedef enum {
@@ -45,6 +49,27 @@ struct ProtocolContext {
 // void(JsonVariantConst input, JsonVariant output)
 using ProtocolMessageHandler = std::function<void(JsonVariantConst, JsonVariant, ProtocolContext)>;
 
+// Completion token for an async command.  It remembers who asked (transport,
+// socket, msgid) inside the ProtocolController, so it is cheap to copy around
+// and can be completed from any task.
+struct ProtocolReply {
+    uint32_t id = 0; // 0 = nobody is waiting
+    bool isValid() const { return id != 0; }
+};
+
+// async handler callback definition
+// return true if the answer will come later through complete(reply, ...),
+// false if output already is the answer (eg. bad parameters)
+using ProtocolAsyncHandler = std::function<bool(JsonVariantConst, JsonVariant, ProtocolContext, ProtocolReply)>;
+
+// blocking work for the async worker task, input is a copy of the request
+using ProtocolAsyncWork = std::function<void(JsonVariantConst input, JsonVariant output)>;
+
+constexpr size_t ybNextPowerOfTwo(size_t n, size_t p = 1)
+{
+  return p >= n ? p : ybNextPowerOfTwo(n, p * 2);
+}
+
 class ProtocolController : public BaseController
 {
   public:
@@ -62,21 +87,69 @@ class ProtocolController : public BaseController
     bool registerCommand(UserRole role, const char* command, ProtocolMessageHandler handler);
 
     // Overload 2: Member Function Helper
+    // Stored as a raw instance + member pointer, so dispatch doesn't go through std::function.
+    // If T is a controller, the handler is called on that controller's task group.
     template <typename T>
     bool registerCommand(UserRole role, const char* command, T* instance, void (T::*method)(JsonVariantConst, JsonVariant, ProtocolContext))
     {
-      // No casting needed on 'this'. We use the explicitly passed 'instance'.
-      return registerCommand(role, command, [instance, method](JsonVariantConst in, JsonVariant out, ProtocolContext context) {
-        (instance->*method)(in, out, context);
-      });
+      using Method = void (T::*)(JsonVariantConst, JsonVariant, ProtocolContext);
+      static_assert(sizeof(Method) <= sizeof(ProtocolCommand::method), "member function pointer is too big");
+
+      ProtocolCommand* entry = addCommand(role, command);
+      if (entry == nullptr)
+        return false;
+
+      entry->instance = instance;
+      entry->owner = ownerOf(instance);
+      memcpy(entry->method, &method, sizeof(Method));
+      entry->invoke = &invokeMember<T>;
+      return true;
+    }
+
+    // Async commands: the handler starts the work and returns right away, the
+    // response goes out later through the transport the request came in on.
+    bool registerAsyncCommand(UserRole role, const char* command, ProtocolAsyncHandler handler);
+
+    template <typename T>
+    bool registerAsyncCommand(UserRole role, const char* command, T* instance, bool (T::*method)(JsonVariantConst, JsonVariant, ProtocolContext, ProtocolReply))
+    {
+      using Method = bool (T::*)(JsonVariantConst, JsonVariant, ProtocolContext, ProtocolReply);
+      static_assert(sizeof(Method) <= sizeof(ProtocolCommand::method), "member function pointer is too big");
+
+      ProtocolCommand* entry = addCommand(role, command);
+      if (entry == nullptr)
+        return false;
+
+      entry->instance = instance;
+      entry->owner = ownerOf(instance);
+      memcpy(entry->method, &method, sizeof(Method));
+      entry->invokeAsync = &invokeAsyncMember<T>;
+      return true;
     }
 
+    // send the response for an async command, false if nobody is waiting anymore
+    bool complete(ProtocolReply reply, JsonVariantConst output);
+
+    // run blocking work on the async worker task, then complete(reply) with its output
+    bool runAsync(ProtocolReply reply, JsonVariantConst input, ProtocolAsyncWork work);
+
+    // numeric id clients can send as "cmd" instead of the name, -1 if unknown
+    int16_t getCommandId(const char* command);
+
+    // Reuse a read-only command's response for ttl_ms (0 = off).  Only
+    // requests with no parameters besides cmd/msgid/user/pass are cached.
+    // Works before or after the command is registered.
+    bool cacheCommand(const char* command, uint32_t ttl_ms);
+
+    // call when something a cached response depends on changes, nullptr = everything
+    void invalidateCache(const char* command = nullptr);
+
     void sendBrightnessUpdate();
     void sendThemeUpdate();
     void sendFastUpdate();
     void sendDebug(const char* message);
     void sendToAll(JsonVariantConst output, UserRole auth_level);
-    void sendToAll(const char* jsonString, UserRole auth_level);
+    void sendToAll(const char* jsonString, UserRole auth_level, JsonVariantConst output = JsonVariantConst());
 
     void handleReceivedJSON(JsonVariantConst input, JsonVariant output, ProtocolContext context);
     static void generateErrorJSON(JsonVariant output, const char* error);
@@ -84,7 +157,27 @@ class ProtocolController : public BaseController
 
     void incrementSentMessages();
 
+    // per-client state for get_update with "delta":true
+    UpdateDelta updateDelta;
+
+    ResponseCache responseCache;
+
+    // the serial api, never blocks the loop
+    SerialTransport serial;
+
+    // drop every subscription for a websocket that went away
+    void unsubscribeAll(int socket);
+
+    // forget async replies for a websocket that went away
+    void cancelReplies(int socket);
+
   private:
+    // checks the response cache with runCommand(), no login needed
+    friend class YarrboardBenchmark;
+
+    // what the serial host last talked to us in, broadcasts go out the same way
+    SerialTransport::Channel serialChannel = SerialTransport::CHANNEL_JSON;
+
     unsigned long previousMessageMillis = 0;
     unsigned int receivedMessages = 0;
     unsigned int receivedMessagesPerSecond = 0;
@@ -96,23 +189,156 @@ class ProtocolController : public BaseController
     // -------------------------------------------------------------------------
     // Dynamic command handler registry
     // -------------------------------------------------------------------------
-    struct CommandEntry {
+    struct ProtocolCommand {
+        const char* name;
+        uint32_t hash;
         UserRole role;
+        bool active;
+        uint32_t cache_ttl_ms; // 0 = not cached
+
+        // member function handlers
+        void* instance;
+        BaseController* owner; // runs on its task group, null = on the caller
+        alignas(void*) uint8_t method[2 * sizeof(void*)];
+
+        // lambdas and free functions
         ProtocolMessageHandler handler;
+
+        void (*invoke)(const ProtocolCommand& command, JsonVariantConst input, JsonVariant output, ProtocolContext context);
+
+        // async handlers, set instead of invoke
+        ProtocolAsyncHandler asyncHandler;
+        bool (*invokeAsync)(const ProtocolCommand& command, JsonVariantConst input, JsonVariant output, ProtocolContext context, ProtocolReply reply);
+    };
+
+    // open addressing table, kept at least half empty so probes stay short
+    static constexpr size_t COMMAND_SLOTS = ybNextPowerOfTwo(YB_PROTOCOL_MAX_COMMANDS * 2);
+    static_assert(YB_PROTOCOL_MAX_COMMANDS < 255, "command ids are stored in a uint8_t");
+
+    // Commands in registration order, index = numeric command id.
+    // Unregistered commands stay in place so ids never move.
+    etl::vector<ProtocolCommand, YB_PROTOCOL_MAX_COMMANDS> commands;
+
+    // hash slot -> command id + 1, 0 = empty
+    uint8_t commandSlots[COMMAND_SLOTS] = {};
+
+    // cacheCommand() ttls by name, so they survive (re-)registering
+    struct CacheTTL {
+        const char* name;
+        uint32_t ttl_ms;
     };
+    etl::vector<CacheTTL, YB_RESPONSE_CACHE_SIZE> cacheTTLs;
+
+    ProtocolCommand* addCommand(UserRole role, const char* command);
+    int16_t findCommand(const char* command);
+    uint32_t getCacheTTL(const char* command);
+
+    static uint32_t hashCommand(const char* command)
+    {
+      // FNV-1a
+      uint32_t hash = 2166136261u;
+      while (*command) {
+        hash ^= (uint8_t)*command++;
+        hash *= 16777619u;
+      }
+      return hash;
+    }
+
+    template <typename T>
+    static void invokeMember(const ProtocolCommand& command, JsonVariantConst input, JsonVariant output, ProtocolContext context)
+    {
+      void (T::*method)(JsonVariantConst, JsonVariant, ProtocolContext);
+      memcpy(&method, command.method, sizeof(method));
+      (static_cast<T*>(command.instance)->*method)(input, output, context);
+    }
 
-    // This tells the Map to compare the TEXT, not the memory addresses.
-    struct StringCompare {
-        bool operator()(const char* lhs, const char* rhs) const
-        {
-          return strcmp(lhs, rhs) < 0;
-        }
+    static void invokeHandler(const ProtocolCommand& command, JsonVariantConst input, JsonVariant output, ProtocolContext context)
+    {
+      command.handler(input, output, context);
+    }
+
+    template <typename T>
+    static bool invokeAsyncMember(const ProtocolCommand& command, JsonVariantConst input, JsonVariant output, ProtocolContext context, ProtocolReply reply)
+    {
+      bool (T::*method)(JsonVariantConst, JsonVariant, ProtocolContext, ProtocolReply);
+      memcpy(&method, command.method, sizeof(method));
+      return (static_cast<T*>(command.instance)->*method)(input, output, context, reply);
+    }
+
+    static bool invokeAsyncHandler(const ProtocolCommand& command, JsonVariantConst input, JsonVariant output, ProtocolContext context, ProtocolReply reply)
+    {
+      return command.asyncHandler(input, output, context, reply);
+    }
+
+    static BaseController* ownerOf(BaseController* controller) { return controller; }
+    static BaseController* ownerOf(void*) { return nullptr; }
+
+    // call the handler on its owner's task group
+    void invokeCommand(const ProtocolCommand& command, JsonVariantConst input, JsonVariant output, ProtocolContext context);
+    bool invokeAsyncCommand(const ProtocolCommand& command, JsonVariantConst input, JsonVariant output, ProtocolContext context, ProtocolReply reply);
+
+    // -------------------------------------------------------------------------
+    // Async commands waiting on their response
+    // -------------------------------------------------------------------------
+    struct PendingReply {
+        uint32_t id;
+        YBMode mode;
+        uint32_t clientId; // websocket socket
+        bool hasMsgid;
+        unsigned int msgid;
+        uint32_t started;
+
+        // http requests wait for the answer in runCommand()
+        SemaphoreHandle_t done;
+        JsonVariant result;
+    };
+
+    struct AsyncJob {
+        ProtocolReply reply;
+        JsonDocument input;
+        ProtocolAsyncWork work;
+
+        AsyncJob() : input(&jsonPool) {}
     };
 
-    // Command map - list of allowed commands, required role, and their callbacks
-    etl::map<const char*, CommandEntry, YB_PROTOCOL_MAX_COMMANDS, StringCompare> commandMap;
+    etl::vector<PendingReply, YB_PROTOCOL_MAX_PENDING> pendingReplies;
+    SemaphoreHandle_t pendingMutex = NULL;
+    uint32_t nextReplyId = 1;
+    uint32_t asyncTimeouts = 0;
+
+    QueueHandle_t workerQueue = NULL;
+    TaskHandle_t workerTask = NULL;
+
+    void runAsyncCommand(const ProtocolCommand& command, JsonVariantConst input, JsonVariant output, ProtocolContext context);
+    bool takeReply(ProtocolReply reply, PendingReply& pending);
+    void expireReplies();
+    void sendReply(const PendingReply& pending, JsonVariantConst output);
+    static void workerLoop(void* arg);
+
+    // -------------------------------------------------------------------------
+    // Push subscriptions, one feed per topic + rate
+    // -------------------------------------------------------------------------
+    struct Subscription {
+        YBHook topic;               // YB_HOOK_UPDATE or YB_HOOK_STATS
+        BaseController* controller; // nullptr = every controller
+        uint32_t rate_ms;
+        uint32_t lastRun;
+        etl::vector<int, YB_CLIENT_LIMIT> sockets;
+    };
+
+    etl::vector<Subscription, YB_MAX_SUBSCRIPTIONS> subscriptions;
+    SemaphoreHandle_t subscriptionMutex = NULL;
+
+    bool parseTopic(const char* name, YBHook& topic, BaseController*& controller);
+    void removeSubscriber(int socket, YBHook topic, BaseController* controller);
+    void runSubscriptions();
+    void generateTopic(const Subscription& sub, JsonVariant output);
 
-    void handleSerialJson();
+    void handleSerialMessage(SerialTransport::Channel channel, char* data, size_t len);
+    void sendSerial(JsonVariantConst output);
+    void handleBatch(JsonVariantConst auth, JsonArrayConst cmds, JsonArray results, ProtocolContext context);
+    void runCommand(JsonVariantConst input, JsonVariant output, ProtocolContext context, bool inBatch = false);
+    static bool hasParameters(JsonVariantConst input);
 
     void handleHello(JsonVariantConst input, JsonVariant output, ProtocolContext context);
     void handleLogin(JsonVariantConst input, JsonVariant output, ProtocolContext context);
@@ -121,11 +347,13 @@ class ProtocolController : public BaseController
     void handleGetConfig(JsonVariantConst input, JsonVariant output, ProtocolContext context);
     void handleGetStats(JsonVariantConst input, JsonVariant output, ProtocolContext context);
     void handleGetUpdate(JsonVariantConst input, JsonVariant output, ProtocolContext context);
+    void handleSubscribe(JsonVariantConst input, JsonVariant output, ProtocolContext context);
+    void handleUnsubscribe(JsonVariantConst input, JsonVariant output, ProtocolContext context);
     void handleGetFullConfig(JsonVariantConst input, JsonVariant output, ProtocolContext context);
     void handleGetNetworkConfig(JsonVariantConst input, JsonVariant output, ProtocolContext context);
     void handleGetAppConfig(JsonVariantConst input, JsonVariant output, ProtocolContext context);
     void handleSetGeneralConfig(JsonVariantConst input, JsonVariant output, ProtocolContext context);
-    void handleSetNetworkConfig(JsonVariantConst input, JsonVariant output, ProtocolContext context);
+    bool handleSetNetworkConfig(JsonVariantConst input, JsonVariant output, ProtocolContext context, ProtocolReply reply);
     void handleSetAuthenticationConfig(JsonVariantConst input, JsonVariant output, ProtocolContext context);
     void handleSetWebServerConfig(JsonVariantConst input, JsonVariant output, ProtocolContext context);
     void handleSetMiscellaneousConfig(JsonVariantConst input, JsonVariant output, ProtocolContext context);
@@ -137,6 +365,7 @@ class ProtocolController : public BaseController
     void handleSetBrightness(JsonVariantConst input, JsonVariant output, ProtocolContext context);
 
     void generateConfigMessage(JsonVariant output);
+    void generateUpdateMessage(JsonVariant output);
 };
 
 #endif /* !YARR_PROTOCOL_H */
\ No newline at end of file
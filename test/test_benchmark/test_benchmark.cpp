@@ -0,0 +1,166 @@
+/*
+ * Yarrboard Framework
+ *
+ * Copyright (c) 2025 Zach Hoeken <hoeken@gmail.com>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+// Host side of the benchmark command, for the parts that don't need a board.
+// The numbers only mean something relative to each other (and to older runs
+// on the same machine), run it with: pio test -e native -f test_benchmark -v
+
+#include "ChunkedPrint.h"
+#include "FrameCodec.h"
+#include "IntervalTimer.h"
+#include "RollingAverage.h"
+#include "TopicWalker.h"
+#include "UpdateDelta.h"
+#include <chrono>
+#include <cstdio>
+#include <unity.h>
+
+static const uint32_t ITERATIONS = 100000;
+
+// keeps the compiler from throwing the work away
+static volatile uint32_t sink;
+
+template <typename F>
+static void bench(const char* name, uint32_t iterations, F&& fn)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < iterations; i++)
+    fn(i);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+  printf("%-28s %8u iterations %10.1f ns/op\n", name, iterations, (double)ns / iterations);
+}
+
+static void makeUpdate(JsonDocument& doc, uint32_t seed)
+{
+  doc["msg"] = "update";
+  doc["uptime"] = seed;
+  JsonArray channels = doc["pwm"].to<JsonArray>();
+  for (int id = 1; id <= 8; id++) {
+    JsonObject ch = channels.add<JsonObject>();
+    ch["id"] = id;
+    ch["state"] = (id & 1) == 0;
+    ch["duty"] = 0.5;
+    ch["current"] = (id == 1) ? seed : 0;
+  }
+}
+
+void setUp() { YarrboardClock::set_us(0); }
+void tearDown() {}
+
+void test_rolling_average()
+{
+  RollingAverage<> ra(RA_DEFAULT_WINDOW);
+  bench("rolling_average_add", ITERATIONS, [&](uint32_t i) {
+    YarrboardClock::advance_us(1000);
+    ra.add(i);
+  });
+  bench("rolling_average_average", ITERATIONS, [&](uint32_t i) {
+    sink = ra.average();
+  });
+  TEST_ASSERT_TRUE(ra.average() > 0);
+}
+
+void test_interval_timer()
+{
+  static IntervalTimer it;
+  it.reset();
+  bench("interval_timer_time", ITERATIONS, [&](uint32_t i) {
+    YarrboardClock::advance_us(10);
+    it.time((i & 1) ? "odd" : "even");
+  });
+  TEST_PASS();
+}
+
+void test_frame_codec()
+{
+  uint8_t payload[256];
+  for (size_t i = 0; i < sizeof(payload); i++)
+    payload[i] = i;
+
+  uint8_t frame[FrameCodec::maxEncodedSize(sizeof(payload))];
+  size_t n = 0;
+  bench("frame_encode_256", ITERATIONS, [&](uint32_t i) {
+    n = FrameCodec::encode(frame, sizeof(frame), 0, 1, payload, sizeof(payload));
+  });
+
+  uint8_t scratch[sizeof(frame)];
+  bool ok = true;
+  bench("frame_decode_256", ITERATIONS, [&](uint32_t i) {
+    uint8_t channel;
+    size_t len;
+    memcpy(scratch, frame, n - 1);
+    ok &= FrameCodec::decode(scratch, n - 1, channel, len);
+  });
+  TEST_ASSERT_TRUE(ok);
+}
+
+void test_chunked_print()
+{
+  JsonDocument update;
+  makeUpdate(update, 1);
+
+  uint8_t buf[1024];
+  size_t total = 0;
+  bench("chunked_serialize_update", ITERATIONS, [&](uint32_t i) {
+    total = 0;
+    ChunkedPrint out(buf, sizeof(buf), [&](const uint8_t* data, size_t len, bool final) {
+      total += len;
+      return true;
+    });
+    serializeJson(update, out);
+    out.finish();
+  });
+  TEST_ASSERT_EQUAL(measureJson(update), total);
+}
+
+void test_update_delta()
+{
+  UpdateDelta delta;
+  uint32_t seq = 0;
+  bench("generate_update_delta", ITERATIONS / 10, [&](uint32_t i) {
+    JsonDocument update;
+    makeUpdate(update, i);
+    JsonDocument out;
+    delta.generate(0, 1, seq, update, out);
+    seq = out["seq"];
+  });
+  TEST_ASSERT_TRUE(seq > 0);
+}
+
+void test_topic_walker()
+{
+  JsonDocument update;
+  makeUpdate(update, 1);
+
+  uint32_t topics = 0;
+  bench("mqtt_traverse_json", ITERATIONS / 10, [&](uint32_t i) {
+    topics = 0;
+    TopicWalker::walk(update, "benchmark", [](void* context, const char* topic, const char* payload) {
+      (*static_cast<uint32_t*>(context))++;
+    }, &topics);
+  });
+  TEST_ASSERT_EQUAL(2 + 8 * 4, topics);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_rolling_average);
+  RUN_TEST(test_interval_timer);
+  RUN_TEST(test_frame_codec);
+  RUN_TEST(test_chunked_print);
+  RUN_TEST(test_update_delta);
+  RUN_TEST(test_topic_walker);
+  return UNITY_END();
+}
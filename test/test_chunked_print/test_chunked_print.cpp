@@ -0,0 +1,82 @@
+/*
+ * Yarrboard Framework
+ *
+ * Copyright (c) 2025 Zach Hoeken <hoeken@gmail.com>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include "ChunkedPrint.h"
+#include <string>
+#include <unity.h>
+#include <vector>
+
+struct Chunk {
+    std::string data;
+    bool final;
+};
+
+static std::vector<Chunk> chunks;
+
+static bool sink(const uint8_t* data, size_t len, bool final)
+{
+  chunks.push_back({std::string((const char*)data, len), final});
+  return true;
+}
+
+void setUp() { chunks.clear(); }
+void tearDown() {}
+
+void test_splits_into_chunks()
+{
+  uint8_t buf[4];
+  ChunkedPrint out(buf, sizeof(buf), sink);
+  out.write((const uint8_t*)"abcdefghij", 10);
+  TEST_ASSERT_TRUE(out.finish());
+
+  TEST_ASSERT_EQUAL(3, chunks.size());
+  TEST_ASSERT_EQUAL_STRING("abcd", chunks[0].data.c_str());
+  TEST_ASSERT_EQUAL_STRING("efgh", chunks[1].data.c_str());
+  TEST_ASSERT_EQUAL_STRING("ij", chunks[2].data.c_str());
+  TEST_ASSERT_FALSE(chunks[1].final);
+  TEST_ASSERT_TRUE(chunks[2].final);
+  TEST_ASSERT_EQUAL(10, out.total());
+}
+
+void test_exact_fit_is_never_an_empty_final_chunk()
+{
+  uint8_t buf[4];
+  ChunkedPrint out(buf, sizeof(buf), sink);
+  out.print("abcd");
+  out.write('e');
+  out.print("fgh");
+  TEST_ASSERT_TRUE(out.finish());
+
+  TEST_ASSERT_EQUAL(2, chunks.size());
+  TEST_ASSERT_EQUAL_STRING("efgh", chunks[1].data.c_str());
+  TEST_ASSERT_TRUE(chunks[1].final);
+}
+
+void test_failed_sink_stops_everything()
+{
+  uint8_t buf[2];
+  ChunkedPrint out(buf, sizeof(buf), [](const uint8_t*, size_t, bool) { return false; });
+  out.write((const uint8_t*)"abcdef", 6);
+
+  TEST_ASSERT_TRUE(out.failed());
+  TEST_ASSERT_FALSE(out.finish());
+  TEST_ASSERT_EQUAL(0, out.write('x'));
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_splits_into_chunks);
+  RUN_TEST(test_exact_fit_is_never_an_empty_final_chunk);
+  RUN_TEST(test_failed_sink_stops_everything);
+  return UNITY_END();
+}
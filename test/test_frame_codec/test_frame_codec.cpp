@@ -0,0 +1,156 @@
+/*
+ * Yarrboard Framework
+ *
+ * Copyright (c) 2025 Zach Hoeken <hoeken@gmail.com>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include "FrameCodec.h"
+#include <cstring>
+#include <unity.h>
+#include <vector>
+
+static std::vector<uint8_t> encode(uint8_t channel, const std::vector<uint8_t>& payload)
+{
+  std::vector<uint8_t> buf(FrameCodec::maxEncodedSize(payload.size()));
+  size_t n = FrameCodec::encode(buf.data(), buf.size(), 0, channel, payload.data(), payload.size());
+  buf.resize(n);
+  return buf;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_crc_matches_ccitt_false()
+{
+  // the standard check value
+  TEST_ASSERT_EQUAL_HEX16(0x29B1, FrameCodec::crc16(0xFFFF, (const uint8_t*)"123456789", 9));
+}
+
+void test_round_trip()
+{
+  std::vector<uint8_t> payload = {'{', '}'};
+  std::vector<uint8_t> frame = encode(1, payload);
+
+  // only the terminator is zero
+  TEST_ASSERT_EQUAL(0, frame.back());
+  TEST_ASSERT_NULL(memchr(frame.data(), 0, frame.size() - 1));
+
+  uint8_t channel;
+  size_t len;
+  TEST_ASSERT_TRUE(FrameCodec::decode(frame.data(), frame.size() - 1, channel, len));
+  TEST_ASSERT_EQUAL(1, channel);
+  TEST_ASSERT_EQUAL(2, len);
+  TEST_ASSERT_EQUAL_MEMORY(payload.data(), frame.data() + 1, len);
+}
+
+void test_encode_wraps_around_a_ring()
+{
+  std::vector<uint8_t> payload = {'a', 'b', 'c', 'd'};
+  std::vector<uint8_t> flat = encode(0, payload);
+
+  uint8_t ring[16];
+  size_t n = FrameCodec::encode(ring, sizeof(ring), 13, 0, payload.data(), payload.size());
+  TEST_ASSERT_EQUAL(flat.size(), n);
+  for (size_t i = 0; i < n; i++)
+    TEST_ASSERT_EQUAL(flat[i], ring[(13 + i) % sizeof(ring)]);
+}
+
+static void assertRoundTrip(uint8_t channel, const std::vector<uint8_t>& payload)
+{
+  std::vector<uint8_t> frame = encode(channel, payload);
+  TEST_ASSERT_TRUE(frame.size() <= FrameCodec::maxEncodedSize(payload.size()));
+  TEST_ASSERT_EQUAL(0, frame.back());
+  TEST_ASSERT_NULL(memchr(frame.data(), 0, frame.size() - 1));
+
+  uint8_t decoded;
+  size_t len;
+  TEST_ASSERT_TRUE(FrameCodec::decode(frame.data(), frame.size() - 1, decoded, len));
+  TEST_ASSERT_EQUAL(channel, decoded);
+  TEST_ASSERT_EQUAL(payload.size(), len);
+  if (len)
+    TEST_ASSERT_EQUAL_MEMORY(payload.data(), frame.data() + 1, len);
+}
+
+void test_block_boundaries()
+{
+  // COBS blocks hold 254 bytes, the channel and crc count towards the first and last
+  for (size_t len = 240; len <= 520; len++) {
+    std::vector<uint8_t> payload(len);
+    for (size_t i = 0; i < len; i++)
+      payload[i] = (i % 255) + 1;
+    assertRoundTrip(1, payload);
+  }
+}
+
+void test_embedded_zeros()
+{
+  assertRoundTrip(0, {});
+  assertRoundTrip(0, {0});
+  assertRoundTrip(1, {0, 0, 0});
+  assertRoundTrip(1, {0, 'a', 0, 'b', 0});
+
+  // a zero right after a full block
+  std::vector<uint8_t> payload(300, 'x');
+  payload[253] = 0;
+  payload[254] = 0;
+  assertRoundTrip(1, payload);
+
+  assertRoundTrip(1, std::vector<uint8_t>(600, 0));
+}
+
+void test_bad_crc_is_rejected()
+{
+  std::vector<uint8_t> frame = encode(1, {'h', 'e', 'l', 'l', 'o'});
+
+  // [code][channel]['h'...], flip a payload bit
+  frame[2] ^= 0x01;
+
+  uint8_t channel;
+  size_t len;
+  TEST_ASSERT_FALSE(FrameCodec::decode(frame.data(), frame.size() - 1, channel, len));
+}
+
+void test_truncated_frame_is_rejected()
+{
+  std::vector<uint8_t> payload(300, 'x');
+  std::vector<uint8_t> frame = encode(1, payload);
+  size_t frameLen = frame.size() - 1;
+
+  uint8_t channel;
+  size_t len;
+  for (size_t cut = 0; cut < frameLen; cut++) {
+    std::vector<uint8_t> copy(frame.begin(), frame.begin() + cut);
+    copy.resize(frameLen);
+    TEST_ASSERT_FALSE(FrameCodec::decode(copy.data(), cut, channel, len));
+  }
+}
+
+void test_zero_code_is_rejected()
+{
+  std::vector<uint8_t> frame = encode(1, {'a', 'b'});
+  frame[0] = 0;
+
+  uint8_t channel;
+  size_t len;
+  TEST_ASSERT_FALSE(FrameCodec::decode(frame.data(), frame.size() - 1, channel, len));
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_crc_matches_ccitt_false);
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_encode_wraps_around_a_ring);
+  RUN_TEST(test_block_boundaries);
+  RUN_TEST(test_embedded_zeros);
+  RUN_TEST(test_bad_crc_is_rejected);
+  RUN_TEST(test_truncated_frame_is_rejected);
+  RUN_TEST(test_zero_code_is_rejected);
+  return UNITY_END();
+}
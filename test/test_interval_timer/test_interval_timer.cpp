@@ -0,0 +1,107 @@
+/*
+ * Yarrboard Framework
+ *
+ * Copyright (c) 2025 Zach Hoeken <hoeken@gmail.com>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include "IntervalTimer.h"
+#include <string>
+#include <unity.h>
+
+class StringPrint : public Print
+{
+  public:
+    std::string text;
+    size_t write(uint8_t b) override
+    {
+      text += (char)b;
+      return 1;
+    }
+    using Print::write;
+};
+
+void setUp() { YarrboardClock::set_us(0); }
+void tearDown() {}
+
+void test_time_records_intervals()
+{
+  IntervalTimer it;
+  it.start();
+
+  YarrboardClock::advance_us(100);
+  it.time("a");
+  YarrboardClock::advance_us(300);
+  it.time("a");
+  YarrboardClock::advance_us(50);
+  it.time("b");
+
+  TEST_ASSERT_EQUAL(2, it.getEntries().size());
+
+  const IntervalTimer::Entry& a = it.getEntries()[0];
+  TEST_ASSERT_EQUAL(2, a.count);
+  TEST_ASSERT_EQUAL(200, a.average());
+  TEST_ASSERT_EQUAL(100, a.min_us);
+  TEST_ASSERT_EQUAL(300, a.max_us);
+  TEST_ASSERT_EQUAL(50, it.getEntries()[1].average());
+}
+
+void test_interned_ids_survive_reset()
+{
+  IntervalTimer it;
+  int16_t id = it.intern("loop");
+  it.start();
+
+  YarrboardClock::advance_us(10);
+  it.time(id);
+  it.reset();
+
+  TEST_ASSERT_EQUAL(0, it.getEntries()[id].count);
+
+  YarrboardClock::advance_us(20);
+  it.time(id);
+  TEST_ASSERT_EQUAL(1, it.getEntries()[id].count);
+  TEST_ASSERT_EQUAL(20, it.getEntries()[id].max_us);
+}
+
+void test_percentile_stays_within_min_max()
+{
+  IntervalTimer it;
+  it.start();
+  for (int i = 0; i < 100; i++) {
+    YarrboardClock::advance_us(i < 99 ? 10 : 5000);
+    it.time("x");
+  }
+
+  const IntervalTimer::Entry& e = it.getEntries()[0];
+  TEST_ASSERT_LESS_OR_EQUAL(16, e.percentile(50));
+  TEST_ASSERT_GREATER_OR_EQUAL(10, e.percentile(50));
+  TEST_ASSERT_LESS_OR_EQUAL(5000, e.percentile(100));
+}
+
+void test_print_goes_to_the_printer()
+{
+  StringPrint out;
+  IntervalTimer it(out);
+  it.start();
+  YarrboardClock::advance_us(42);
+  it.time("label");
+  it.print();
+
+  TEST_ASSERT_NOT_EQUAL(std::string::npos, out.text.find("label: avg=42"));
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_time_records_intervals);
+  RUN_TEST(test_interned_ids_survive_reset);
+  RUN_TEST(test_percentile_stays_within_min_max);
+  RUN_TEST(test_print_goes_to_the_printer);
+  return UNITY_END();
+}
@@ -0,0 +1,77 @@
+/*
+ * Yarrboard Framework
+ *
+ * Copyright (c) 2025 Zach Hoeken <hoeken@gmail.com>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include "RollingAverage.h"
+#include <unity.h>
+
+void setUp() { YarrboardClock::set_us(0); }
+void tearDown() {}
+
+void test_average_min_max()
+{
+  RollingAverage<uint32_t, 8> ra(1000);
+  ra.add(10);
+  ra.add(30);
+  ra.add(20);
+
+  TEST_ASSERT_EQUAL(20, ra.average());
+  TEST_ASSERT_EQUAL(10, ra.min());
+  TEST_ASSERT_EQUAL(30, ra.max());
+  TEST_ASSERT_EQUAL(20, ra.average(false));
+}
+
+void test_samples_age_out()
+{
+  RollingAverage<uint32_t, 8> ra(1000);
+  ra.add(100);
+  YarrboardClock::advance_ms(600);
+  ra.add(200);
+  YarrboardClock::advance_ms(600);
+
+  TEST_ASSERT_EQUAL(200, ra.average());
+  TEST_ASSERT_EQUAL(200, ra.min());
+
+  YarrboardClock::advance_ms(1000);
+  TEST_ASSERT_EQUAL(0, ra.average());
+}
+
+void test_full_buffer_drops_oldest()
+{
+  RollingAverage<int32_t, 4> ra(1000);
+  const int32_t samples[] = {-100, 1, 2, 3, 4};
+  for (int32_t v : samples)
+    ra.add(v);
+
+  TEST_ASSERT_EQUAL(1, ra.min());
+  TEST_ASSERT_EQUAL(4, ra.max());
+  TEST_ASSERT_EQUAL(2, ra.average());
+}
+
+void test_float_samples()
+{
+  RollingAverage<float, 4> ra(1000);
+  ra.add(1.5f);
+  ra.add(2.5f);
+
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 2.0f, ra.average());
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.5f, ra.snapshot().stddev);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_average_min_max);
+  RUN_TEST(test_samples_age_out);
+  RUN_TEST(test_full_buffer_drops_oldest);
+  RUN_TEST(test_float_samples);
+  return UNITY_END();
+}
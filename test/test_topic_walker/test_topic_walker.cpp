@@ -0,0 +1,68 @@
+/*
+ * Yarrboard Framework
+ *
+ * Copyright (c) 2025 Zach Hoeken <hoeken@gmail.com>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include "TopicWalker.h"
+#include <string>
+#include <unity.h>
+#include <vector>
+
+static std::vector<std::pair<std::string, std::string>> published;
+
+static void collect(void* context, const char* topic, const char* payload)
+{
+  published.push_back({topic, payload});
+}
+
+void setUp() { published.clear(); }
+void tearDown() {}
+
+void test_objects_and_arrays_become_topics()
+{
+  JsonDocument doc;
+  doc["duty"] = 0.5;
+  doc["name"] = "Pump";
+  JsonArray state = doc["state"].to<JsonArray>();
+  state.add(true);
+  state.add(false);
+
+  TopicWalker::walk(doc, "pwm/1", collect, nullptr);
+
+  TEST_ASSERT_EQUAL(4, published.size());
+  TEST_ASSERT_EQUAL_STRING("pwm/1/duty", published[0].first.c_str());
+  TEST_ASSERT_EQUAL_STRING("0.5", published[0].second.c_str());
+  TEST_ASSERT_EQUAL_STRING("pwm/1/name", published[1].first.c_str());
+  TEST_ASSERT_EQUAL_STRING("Pump", published[1].second.c_str());
+  TEST_ASSERT_EQUAL_STRING("pwm/1/state/0", published[2].first.c_str());
+  TEST_ASSERT_EQUAL_STRING("true", published[2].second.c_str());
+  TEST_ASSERT_EQUAL_STRING("pwm/1/state/1", published[3].first.c_str());
+  TEST_ASSERT_EQUAL_STRING("false", published[3].second.c_str());
+}
+
+void test_long_topics_are_truncated()
+{
+  std::string key(TopicWalker::TOPIC_CAP * 2, 'k');
+  JsonDocument doc;
+  doc[key] = 1;
+
+  TopicWalker::walk(doc, "prefix", collect, nullptr);
+
+  TEST_ASSERT_EQUAL(1, published.size());
+  TEST_ASSERT_EQUAL(TopicWalker::TOPIC_CAP - 1, published[0].first.size());
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_objects_and_arrays_become_topics);
+  RUN_TEST(test_long_topics_are_truncated);
+  return UNITY_END();
+}
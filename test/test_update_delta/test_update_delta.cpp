@@ -0,0 +1,93 @@
+/*
+ * Yarrboard Framework
+ *
+ * Copyright (c) 2025 Zach Hoeken <hoeken@gmail.com>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include "UpdateDelta.h"
+#include <unity.h>
+
+static JsonDocument makeUpdate(int a, int b)
+{
+  JsonDocument doc;
+  doc["msg"] = "update";
+  JsonArray channels = doc["pwm"].to<JsonArray>();
+  JsonObject ch1 = channels.add<JsonObject>();
+  ch1["id"] = 1;
+  ch1["duty"] = a;
+  JsonObject ch2 = channels.add<JsonObject>();
+  ch2["id"] = 2;
+  ch2["duty"] = b;
+  return doc;
+}
+
+void setUp() { YarrboardClock::set_us(0); }
+void tearDown() {}
+
+void test_first_update_is_full()
+{
+  UpdateDelta delta;
+  JsonDocument out;
+  delta.generate(0, 1, 0, makeUpdate(1, 2), out);
+
+  TEST_ASSERT_FALSE(out["delta"].is<bool>());
+  TEST_ASSERT_EQUAL(2, out["pwm"].size());
+  TEST_ASSERT_EQUAL(1, out["seq"].as<int>());
+}
+
+void test_only_changed_channels_are_sent()
+{
+  UpdateDelta delta;
+  JsonDocument first;
+  delta.generate(0, 1, 0, makeUpdate(1, 2), first);
+
+  JsonDocument second;
+  delta.generate(0, 1, first["seq"].as<uint32_t>(), makeUpdate(1, 5), second);
+
+  TEST_ASSERT_TRUE(second["delta"].as<bool>());
+  TEST_ASSERT_EQUAL_STRING("update", second["msg"].as<const char*>());
+  TEST_ASSERT_EQUAL(1, second["pwm"].size());
+  TEST_ASSERT_EQUAL(2, second["pwm"][0]["id"].as<int>());
+  TEST_ASSERT_EQUAL(5, second["pwm"][0]["duty"].as<int>());
+}
+
+void test_wrong_seq_gets_a_full_update()
+{
+  UpdateDelta delta;
+  JsonDocument first;
+  delta.generate(0, 1, 0, makeUpdate(1, 2), first);
+
+  JsonDocument second;
+  delta.generate(0, 1, 12345, makeUpdate(1, 2), second);
+
+  TEST_ASSERT_FALSE(second["delta"].is<bool>());
+  TEST_ASSERT_EQUAL(2, second["pwm"].size());
+}
+
+void test_forget_resets_the_client()
+{
+  UpdateDelta delta;
+  JsonDocument first;
+  delta.generate(0, 1, 0, makeUpdate(1, 2), first);
+  delta.forget(0, 1);
+
+  JsonDocument second;
+  delta.generate(0, 1, first["seq"].as<uint32_t>(), makeUpdate(1, 2), second);
+  TEST_ASSERT_FALSE(second["delta"].is<bool>());
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_first_update_is_full);
+  RUN_TEST(test_only_changed_channels_are_sent);
+  RUN_TEST(test_wrong_seq_gets_a_full_update);
+  RUN_TEST(test_forget_resets_the_client);
+  return UNITY_END();
+}